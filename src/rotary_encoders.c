@@ -11,17 +11,160 @@
 ///
 #include "rotary_encoders.h"
 
-/// Flags used to track events from interrupts, each bit is the instance flagged
-volatile uint32_t rotary_encoder_cw_flags = 0;
-volatile uint32_t rotary_encoder_ccw_flags = 0;
-volatile uint32_t rotary_encoder_sw_flags = 0;
-
-///@todo If knob_min/max == INT16_MIN/MAX there will be some glitches.
-///      If your rotary encoder requires 32767 points then this code is probably
-///      not the best thing to use.
+#if ROTARY_ENCODER_MULTI_READER || ROTARY_ENCODER_FRAMES || \
+    (ROTARY_ENCODER_BANKS > 1u)
+#include <stdatomic.h>
+#endif
+
+#if ROTARY_ENCODER_FRAMES && (ROTARY_ENCODER_FRAMES < 2u)
+#error "ROTARY_ENCODER_FRAMES needs at least 2 buffers, 3 recommended"
+#endif
+
+#if (ROTARY_ENCODER_BANKS > 1u) && !ROTARY_ENCODER_MULTI_READER
+#error "ROTARY_ENCODER_BANKS > 1 needs ROTARY_ENCODER_MULTI_READER for reads across cores"
+#endif
+
+#if ROTARY_ENCODER_SELF_CHECK && !defined(ROTARY_ENCODER_ASSERT)
+#include <assert.h>
+#define ROTARY_ENCODER_ASSERT(expr) assert(expr)
+#endif
+
+#if ROTARY_ENCODER_MULTI_READER || ROTARY_ENCODER_FRAMES
+/// Bits of shared_state above the knob value in the low 16 bits
+#define ROTARY_ENCODER_SHARED_SW    0x00010000u
+#define ROTARY_ENCODER_SHARED_EVENT 0x00020000u
+#define ROTARY_ENCODER_SHARED_ALERT 0x00040000u
+#endif
+
+#if ROTARY_ENCODER_INERTIA
+/// Coasting stops once slower than this, in 1/256 steps per task call
+#define ROTARY_ENCODER_COAST_STOP 16u
+#endif
+
+/// Flags used to track events from interrupts, one set of words per bank.
+/// Kept apart from the task state below, interrupts only ever write these.
+rotary_encoder_bank_flags_t rotary_encoder_bank_flags[ROTARY_ENCODER_BANKS] = {0};
+
+/// Bank each instance is assigned to
+uint8_t rotary_encoder_instance_bank[ROTARY_ENCODER_INSTANCES] = {0};
+
+#if ROTARY_ENCODER_ISR_STATE
+/// State the interrupt functions keep for each instance
+rotary_encoder_isr_state_t rotary_encoder_isr_state[ROTARY_ENCODER_INSTANCES] = {0};
+#endif
+
+#if ROTARY_ENCODER_DELTA_INPUT
+#if ROTARY_ENCODER_ATOMIC_FLAGS
+/// Delta accumulator, summed by producers and taken by the task
+typedef _Atomic int32_t rotary_encoder_delta_word_t;
+#else
+/// Delta accumulator, summed by producers and taken by the task
+typedef volatile int32_t rotary_encoder_delta_word_t;
+#endif
+
+/// Largest total fed between task calls, sums past it saturate.  Far beyond
+/// any real input, and small enough that a knob value plus it never overflows.
+#define ROTARY_ENCODER_DELTA_LIMIT 0x3FFFFFFF
+
+/// Deltas fed but not yet taken by the task, one per instance, on its own
+/// cache line with ROTARY_ENCODER_PADDED_LAYOUT as producers may be on any core
+typedef struct rotary_encoder_delta_acc
+{
+    ROTARY_ENCODER_LINE_ALIGN rotary_encoder_delta_word_t sum;
+
+} rotary_encoder_delta_acc_t;
+
+static rotary_encoder_delta_acc_t delta_acc_arr[ROTARY_ENCODER_INSTANCES] = {0};
+#endif
+
+#if ROTARY_ENCODER_WATCHDOG
+/// Pending work older than this calls the watchdog hook, 0 disables
+static uint32_t watchdog_threshold = 0;
+
+/// Called once per instance each time its work gets too old, null if none
+static rotary_encoder_watchdog_hook_t watchdog_hook = 0;
+
+/// Instances already reported for the work pending now
+static uint32_t watchdog_fired_flags = 0;
+
+/// Oldest pending work seen by rotary_encoder_watchdog_check()
+static uint32_t watchdog_max_age = 0;
+#endif
+
+#if ROTARY_ENCODER_COST_BUDGET
+/// Handling an instance event longer than this calls the cost hook, 0 disables
+static uint32_t cost_budget = 0;
+
+/// Called with the instance and cost of a slow event, null if none
+static rotary_encoder_cost_hook_t cost_hook = 0;
+#endif
+
+#if ROTARY_ENCODER_STORM_GUARD
+/// Hardware access for the storm guard, null until set
+static rotary_encoder_storm_hooks_t const * p_storm_hooks = 0;
+#endif
+
+#if ROTARY_ENCODER_LATENCY
+#if ROTARY_ENCODER_MULTI_READER
+/// Bank time and latency counts, atomic as readers on any thread use them
+typedef _Atomic uint64_t rotary_encoder_time_word_t;
+typedef atomic_uint rotary_encoder_count_word_t;
+#else
+/// Bank time and latency counts
+typedef uint64_t rotary_encoder_time_word_t;
+typedef uint32_t rotary_encoder_count_word_t;
+#endif
+#endif
+
+/// Task state for the instances assigned to one core
+typedef struct rotary_encoder_bank
+{
+    /// Flags taken from the interrupt flags but not yet handled by a task call.
+    /// rotary_encoder_task_budget() leaves work here to finish on later calls.
+    ROTARY_ENCODER_BANK_ALIGN uint32_t pending_cw_flags;
+    uint32_t pending_ccw_flags;
+    uint32_t pending_sw_flags;
+#if ROTARY_ENCODER_DELTA_INPUT
+    uint32_t pending_delta_flags;
+#endif
+
+    uint32_t member_flags;       /// Instances assigned to this bank
+
+#if ROTARY_ENCODER_INERTIA
+    uint32_t tick;               /// Task calls so far, the inertia time base
+    uint32_t inertia_flags;      /// Instances turning fast or coasting
+#endif
+
+#if ROTARY_ENCODER_SLEW
+    uint32_t ramp_flags;         /// Instances with output not at the knob value
+#endif
+
+#if ROTARY_ENCODER_LATENCY
+    /// ROTARY_ENCODER_TIMESTAMP() extended to 64 bits, only the task moves it.
+    /// Its low bits are the timestamp it was last extended with.
+    rotary_encoder_time_word_t time;
+    rotary_encoder_count_word_t latency_max;      /// Longest latency since the last reset
+    rotary_encoder_count_word_t latency_hist[32]; /// Latencies counted by log2 of their ticks
+#endif
+
+#if ROTARY_ENCODER_COST_BUDGET
+    uint32_t cost_max;           /// Longest event handling since the budget was set
+#endif
+
+#if ROTARY_ENCODER_BANKS > 1u
+    atomic_uint changed_flags;   /// Instances changed since the last publish
+#elif ROTARY_ENCODER_FRAMES || ROTARY_ENCODER_PASS_HOOKS
+    uint32_t changed_flags;      /// Instances changed since the last publish
+#endif
+
+} rotary_encoder_bank_t;
+
+/// Bounds are kept with min <= max, stepping is done in 32 bits so the full
+/// INT16_MIN to INT16_MAX range works
 typedef struct rotary_encoder
 {
-    bool b_initialized;          /// Is this instance being used
+    /// Padded layout gives every instance its own cache lines
+    ROTARY_ENCODER_LINE_ALIGN bool b_initialized; /// Is this instance being used
 
     int16_t knob_value;          /// Relative knob turn value
     int16_t knob_max_value;      /// Max value of knob
@@ -35,20 +178,209 @@ typedef struct rotary_encoder
     bool b_event_occured;       /// Event occurred, cleared after being read
                                 /// Used to find out if a value was updated
     bool b_alert_occured;       /// Used to find out if a value was stepped on
+                                /// Sticky, cleared after being read
+
+#if ROTARY_ENCODER_DELTA_INPUT
+    int32_t knob_range;         /// Values from min to max, 0 or less if min > max
+    uint32_t knob_range_recip;  /// 0xFFFFFFFF / knob_range, for wrap without divide
+#endif
+
+#if ROTARY_ENCODER_NOTIFY_THRESHOLD
+    int16_t notified_value;     /// Knob value at the last notification
+    uint16_t notify_threshold;  /// Smallest move notified, 0 and 1 notify all
+#endif
+
+#if ROTARY_ENCODER_ALERT_BITS
+    uint8_t alert_bits;         /// ROTARY_ENCODER_ALERT bits since the last take
+    uint16_t alert_count;       /// Bounds hit since the last take, saturates
+#endif
+
+#if ROTARY_ENCODER_REVERSAL_FILTER
+    int8_t last_dir;            /// 1 clockwise, -1 counter clockwise, 0 none
+    uint8_t reversal_count;     /// Opposite events in a row not yet taken
+    uint8_t reversal_events;    /// Opposite events in a row to take, 0 disables
+    uint32_t reversal_dwell;    /// Steps closer than this count as fast
+    uint32_t last_step_time;    /// Timestamp of the last step taken
+    uint32_t last_step_gap;     /// Time between the last two steps taken
+#endif
+
+#if ROTARY_ENCODER_INERTIA
+    uint16_t coast_min_velocity; /// Flicks this fast coast, 0 disables
+    uint8_t coast_decay;        /// Velocity kept per task call, out of 256
+    bool b_coast_cw;            /// Direction of the last turn or coast
+    bool b_coasting;            /// Stepping on its own after a flick
+    uint16_t velocity;          /// In 1/256 steps per task call
+    uint16_t coast_acc;         /// Fraction of a step built up while coasting
+    uint32_t last_turn_tick;    /// Bank tick of the last turn
+    uint32_t turn_interval;     /// Bank ticks between the last two turns
+#endif
+
+#if ROTARY_ENCODER_SLEW
+    int16_t output_value;       /// Follows knob_value, slew_rate per task call
+    uint16_t slew_rate;         /// Max output change per task call, 0 disables
+#endif
+
+#if ROTARY_ENCODER_PARAMS
+    rotary_encoder_param_t * p_param; /// Bound parameter, null if none
+    bool b_param_picked_up;     /// Knob value is written to the parameter
+    int8_t param_side;          /// Sign of knob minus parameter value at bind
+#endif
+
+#if ROTARY_ENCODER_LATENCY
+    uint64_t event_time;        /// Bank time of the first interrupt of the event
+#endif
+
+#if ROTARY_ENCODER_MULTI_READER
+    atomic_uint seq;            /// Sequence lock, odd while the task writes
+    atomic_uint shared_state;   /// Copy for readers, see ROTARY_ENCODER_SHARED_SW
+#if ROTARY_ENCODER_SLEW
+    atomic_uint shared_output;  /// Copy of output_value for readers
+#endif
+#endif
 
 } rotary_encoder_t;
 
 /// Array that tracks instances
 static rotary_encoder_t instance_arr[ROTARY_ENCODER_INSTANCES] = {0};
 
+/// Banks of instances, every instance starts in bank 0
+static rotary_encoder_bank_t bank_arr[ROTARY_ENCODER_BANKS] =
+{
+    [0].member_flags = (uint32_t)(((uint64_t)1u << ROTARY_ENCODER_INSTANCES) - 1u)
+};
+
+#if ROTARY_ENCODER_TASK_BUDGET
+/// Instance rotary_encoder_task_budget() starts looking at on its next call
+static uint8_t task_cursor = 0;
+#endif
+
+#if ROTARY_ENCODER_FRAMES
+/// Published frames, the task fills the one after the front and swaps it in
+static rotary_encoder_frame_t frame_arr[ROTARY_ENCODER_FRAMES] = {0};
+
+/// Frame readers get, only ever changed by one atomic store
+static _Atomic(rotary_encoder_frame_t const *) p_front_frame = &frame_arr[0];
+
+/// Next frame to fill, never the front frame
+static uint8_t frame_back = 1;
+
+/// Sequence word of each frame, odd while the task fills it
+static atomic_uint frame_seq_arr[ROTARY_ENCODER_FRAMES] = {0};
 
-static bool rotary_encoder_force_bounds(uint8_t const instance_num);
+/// Words of each frame for rotary_encoder_copy_frame(), the frame number, the
+/// state of each instance packed as shared_state, then each output value
+#if ROTARY_ENCODER_SLEW
+#define ROTARY_ENCODER_FRAME_WORDS (1u + (2u * ROTARY_ENCODER_INSTANCES))
+#else
+#define ROTARY_ENCODER_FRAME_WORDS (1u + ROTARY_ENCODER_INSTANCES)
+#endif
+
+/// Copy of each frame that copy_frame() reads while the task may refill it,
+/// atomic so that read is no data race
+static atomic_uint frame_word_arr[ROTARY_ENCODER_FRAMES][ROTARY_ENCODER_FRAME_WORDS] = {0};
+#endif
+
+#if ROTARY_ENCODER_PASS_HOOKS
+/// Functions called with the changed instances at the end of a task call
+static rotary_encoder_pass_hook_t pass_hook_arr[ROTARY_ENCODER_PASS_HOOKS] = {0};
+#endif
+
+
+static bool rotary_encoder_force_bounds(uint8_t const instance_num,
+                                        int32_t const value);
 static bool rotary_encoder_initialized(uint8_t const instance_num);
+static void rotary_encoder_alert(uint8_t const instance_num,
+                                 bool const b_max,
+                                 bool const b_step_on);
+#if ROTARY_ENCODER_STORM_GUARD
+static void rotary_encoder_storm_release(uint8_t const instance_num);
+#endif
+static void rotary_encoder_collect_flags(uint8_t const bank_num);
+static uint32_t rotary_encoder_take_flags(rotary_encoder_flag_word_t * const p_word);
+#if ROTARY_ENCODER_EVENT_TIME
+static void rotary_encoder_set_held(rotary_encoder_bank_flags_t * const p_flags,
+                                    uint32_t const held_flags);
+#endif
+#if ROTARY_ENCODER_BANKS > 1u
+static void rotary_encoder_move_flag(rotary_encoder_flag_word_t * const p_from,
+                                     rotary_encoder_flag_word_t * const p_to,
+                                     uint8_t const instance_num);
+#endif
+static void rotary_encoder_run_bank(uint8_t const bank_num);
+#if ROTARY_ENCODER_LATENCY
+static uint64_t rotary_encoder_clock(uint8_t const bank_num);
+static uint64_t rotary_encoder_clock_now(uint8_t const bank_num);
+static void rotary_encoder_latency_sample(uint8_t const instance_num);
+#endif
+static void rotary_encoder_tick(uint8_t const bank_num);
+static bool rotary_encoder_pending(uint8_t const instance_num);
+static void rotary_encoder_process(uint8_t const instance_num);
+#if ROTARY_ENCODER_COST_BUDGET
+static void rotary_encoder_charge(uint8_t const instance_num, uint32_t const start);
+#endif
+static void rotary_encoder_step(uint8_t const instance_num, bool const b_up);
+#if ROTARY_ENCODER_DELTA_INPUT
+static int32_t rotary_encoder_delta_sum(int32_t const acc, int16_t const delta);
+static int32_t rotary_encoder_take_delta(uint8_t const instance_num);
+static void rotary_encoder_move(uint8_t const instance_num, int32_t const delta);
+static int32_t rotary_encoder_wrap(rotary_encoder_t const * const p_inst,
+                                   int32_t const offset);
+#endif
+#if ROTARY_ENCODER_SELF_CHECK
+static int32_t rotary_encoder_ref_move(rotary_encoder_t const * const p_inst,
+                                       int32_t const delta);
+static void rotary_encoder_self_check(uint8_t const instance_num,
+                                      int32_t const ref_value);
+#endif
+static bool rotary_encoder_turn(uint8_t const instance_num, bool const b_cw);
+#if ROTARY_ENCODER_INERTIA
+static void rotary_encoder_track_velocity(uint8_t const instance_num, bool const b_cw);
+static void rotary_encoder_coast(uint8_t const bank_num);
+static void rotary_encoder_coast_instance(uint8_t const instance_num);
+static void rotary_encoder_stop_coast(uint8_t const instance_num);
+#endif
+#if ROTARY_ENCODER_SLEW
+static void rotary_encoder_ramp(uint8_t const bank_num);
+#endif
+static void rotary_encoder_reset(uint8_t const instance_num,
+                                 int16_t const min_value,
+                                 int16_t const max_value,
+                                 bool    const step_on,
+                                 bool    const cw_rot_pos);
+static void rotary_encoder_set_bounds(uint8_t const instance_num,
+                                      int16_t const min_value,
+                                      int16_t const max_value,
+                                      bool    const step_on);
+static void rotary_encoder_write_begin(uint8_t const instance_num);
+static void rotary_encoder_write_end(uint8_t const instance_num);
+static void rotary_encoder_write_finish(uint8_t const instance_num,
+                                        bool const b_publish);
+#if ROTARY_ENCODER_NOTIFY_THRESHOLD
+static bool rotary_encoder_notify(uint8_t const instance_num, bool const b_switch);
+#endif
+#if ROTARY_ENCODER_PARAMS
+static void rotary_encoder_param_sync(uint8_t const instance_num);
+#endif
+static void rotary_encoder_read(uint8_t const instance_num,
+                                rotary_encoder_snapshot_t * const p_snapshot);
+#if ROTARY_ENCODER_MULTI_READER || ROTARY_ENCODER_FRAMES
+static void rotary_encoder_unpack(unsigned const state,
+                                  rotary_encoder_snapshot_t * const p_snapshot);
+#endif
+#if ROTARY_ENCODER_FRAMES
+static unsigned rotary_encoder_pack(rotary_encoder_snapshot_t const * const p_snapshot);
+#endif
+#if ROTARY_ENCODER_MULTI_READER
+static void rotary_encoder_share(rotary_encoder_t * const p_inst);
+#else
+static void rotary_encoder_copy(rotary_encoder_t const * const p_inst,
+                                rotary_encoder_snapshot_t * const p_snapshot);
+#endif
 
 /// Init instance of rotary encoder
 /// @param instance_num Instance number to track in module
 /// @param min_value    Min value the knob can report
-/// @param max_value    Max value the knob can report
+/// @param max_value    Max value the knob can report, at least min_value
 /// @param step_on      True if step on value if meets max/min
 ///                     False if allow rollover from max to min, and min to max
 /// @param cw_rot_ps    True if clockwise rotation is positive, false if negative
@@ -61,23 +393,44 @@ bool rotary_encoder_init(uint8_t const instance_num,
 {
     bool b_status = false;
 
-    // Check that instance is within array bounds
-    if(ROTARY_ENCODER_INSTANCES > instance_num)
+    // Check that instance is within array bounds and the bounds make sense
+    if((ROTARY_ENCODER_INSTANCES > instance_num) && (min_value <= max_value))
     {
-      instance_arr[instance_num].b_initialized = true;
+      rotary_encoder_reset(instance_num, min_value, max_value, step_on, cw_rot_pos);
+
+      b_status = true;
+    }
+
+    return b_status;
+}
+
+/// Init instances from a board table, entry n sets up instance n
+/// Checks every entry first, so a bad table changes nothing
+/// @param p_cfg_arr Table of count entries, can be const in flash
+/// @param count     Number of entries, instances past it are left alone
+/// @return True on success, false on error
+bool rotary_encoder_init_all(rotary_encoder_config_t const * const p_cfg_arr,
+                             uint8_t const count)
+{
+    bool b_status = (0 != p_cfg_arr) && (ROTARY_ENCODER_INSTANCES >= count);
 
-      instance_arr[instance_num].knob_value = 0;
-      instance_arr[instance_num].knob_max_value = max_value;
-      instance_arr[instance_num].knob_min_value = min_value;
-      instance_arr[instance_num].b_knob_allow_step_on = step_on;
-      instance_arr[instance_num].b_knob_cw_rot_positive = cw_rot_pos;
+    for(uint8_t i = 0; (i < count) && b_status; i++)
+    {
+        b_status = (ROTARY_ENCODER_BANKS > p_cfg_arr[i].bank_num) &&
+                   (p_cfg_arr[i].min_value <= p_cfg_arr[i].max_value);
+    }
 
-      instance_arr[instance_num].switch_value = 0;
+    for(uint8_t i = 0; (i < count) && b_status; i++)
+    {
+        rotary_encoder_config_t const * const p_cfg = &p_cfg_arr[i];
 
-      instance_arr[instance_num].b_event_occured = false;
-      instance_arr[instance_num].b_alert_occured = false;
+        if(p_cfg->bank_num != rotary_encoder_instance_bank[i])
+        {
+            rotary_encoder_set_bank(i, p_cfg->bank_num);
+        }
 
-      b_status = true;
+        rotary_encoder_reset(i, p_cfg->min_value, p_cfg->max_value,
+                             p_cfg->b_step_on, p_cfg->b_cw_rot_pos);
     }
 
     return b_status;
@@ -93,7 +446,10 @@ int16_t rotary_encoder_get_knob_value(uint8_t const instance_num)
     // Check that instance is within array bounds
     if(rotary_encoder_initialized(instance_num))
     {
-        status = instance_arr[instance_num].knob_value;
+        rotary_encoder_snapshot_t snapshot;
+
+        rotary_encoder_read(instance_num, &snapshot);
+        status = snapshot.knob_value;
     }
 
     return status;
@@ -109,7 +465,31 @@ bool rotary_encoder_get_switch_value(uint8_t const instance_num)
     // Check that instance is within array bounds
     if(rotary_encoder_initialized(instance_num))
     {
-        b_status = instance_arr[instance_num].switch_value;
+        rotary_encoder_snapshot_t snapshot;
+
+        rotary_encoder_read(instance_num, &snapshot);
+        b_status = snapshot.b_switch_value;
+    }
+
+    return b_status;
+}
+
+/// Get a consistent copy of the instance value, switch and event state
+/// Safe to call from any number of threads while rotary_encoder_task() runs
+/// when ROTARY_ENCODER_MULTI_READER is enabled.  Never blocks the task, and
+/// does not clear the event or alert like the check functions do.
+/// @param instance_num Instance number of encoder to get
+/// @param p_snapshot   Where to copy the instance state
+/// @return True on success, false on error
+bool rotary_encoder_get_snapshot(uint8_t const instance_num,
+                                 rotary_encoder_snapshot_t * const p_snapshot)
+{
+    bool b_status = false;
+
+    if(rotary_encoder_initialized(instance_num) && (0 != p_snapshot))
+    {
+        rotary_encoder_read(instance_num, p_snapshot);
+        b_status = true;
     }
 
     return b_status;
@@ -127,10 +507,17 @@ bool rotary_encoder_set_knob_value(uint8_t const instance_num,
     // Check that instance is within array bounds
     if(rotary_encoder_initialized(instance_num))
     {
-        instance_arr[instance_num].knob_value = value;
-        rotary_encoder_force_bounds(instance_num);
+        rotary_encoder_write_begin(instance_num);
+        rotary_encoder_force_bounds(instance_num, value);
 
-        b_status = true;;
+#if ROTARY_ENCODER_NOTIFY_THRESHOLD
+        // Moves are measured from what the application set
+        instance_arr[instance_num].notified_value = instance_arr[instance_num].knob_value;
+#endif
+
+        rotary_encoder_write_end(instance_num);
+
+        b_status = true;
     }
 
     return b_status;
@@ -146,8 +533,9 @@ bool rotary_encoder_inc_knob_value(uint8_t const instance_num)
     // Check that instance is within array bounds
     if(rotary_encoder_initialized(instance_num))
     {
-            ++instance_arr[instance_num].knob_value;
-            rotary_encoder_force_bounds(instance_num);
+            rotary_encoder_write_begin(instance_num);
+            rotary_encoder_step(instance_num, true);
+            rotary_encoder_write_end(instance_num);
 
             b_status = true;
     }
@@ -165,8 +553,9 @@ bool rotary_encoder_dec_knob_value(uint8_t const instance_num)
     // Check that instance is within array bounds
     if(rotary_encoder_initialized(instance_num))
     {
-            --instance_arr[instance_num].knob_value;
-            rotary_encoder_force_bounds(instance_num);
+            rotary_encoder_write_begin(instance_num);
+            rotary_encoder_step(instance_num, false);
+            rotary_encoder_write_end(instance_num);
 
             b_status = true;
     }
@@ -184,8 +573,11 @@ bool rotary_encoder_tog_switch_value(uint8_t const instance_num)
     // Check that instance is within array bounds
     if(rotary_encoder_initialized(instance_num))
     {
+        rotary_encoder_write_begin(instance_num);
         instance_arr[instance_num].switch_value =
                 !instance_arr[instance_num].switch_value;
+        rotary_encoder_write_end(instance_num);
+
         b_status = true;
     }
 
@@ -194,13 +586,14 @@ bool rotary_encoder_tog_switch_value(uint8_t const instance_num)
 
 /// Set rotary encoder flags
 /// This is meant to be used in an interrupt, or to trigger an event manually
+/// For the fastest interrupts see rotary_encoder_isr_cw() and friends
 /// It will only set the flags, never clear them.  Flags are cleared when read.
 /// @param instance_num Instance number of encoder flags to set
 /// @param flag         The flag value to set. Valid options are:
 ///                     ROTARY_ENCODER_FLAG_CW  (Clockwise)
 ///                     ROTARY_ENCODER_FLAG_CCW (Counter clockwise)
 ///                     ROTARY_ENCODER_FLAG_SW  (Switch)
-/// @return True if flags were set, false if not
+/// @return True if flags were set, false if not or dropped as a glitch
 bool rotary_encoder_set_flags(uint8_t const instance_num,
                               uint8_t const flag)
 {
@@ -210,19 +603,17 @@ bool rotary_encoder_set_flags(uint8_t const instance_num,
     {
         if(ROTARY_ENCODER_FLAG_CW  == flag)
         {
-            rotary_encoder_cw_flags |= (1u << instance_num);
-            b_status = true;
+            b_status = rotary_encoder_isr_cw(instance_num);
         }
 
         if(ROTARY_ENCODER_FLAG_CCW  == flag)
         {
-            rotary_encoder_ccw_flags |= (1u << instance_num);
-            b_status = true;
+            b_status = rotary_encoder_isr_ccw(instance_num);
         }
 
         if(ROTARY_ENCODER_FLAG_SW  == flag)
         {
-            rotary_encoder_sw_flags |= (1u << instance_num);
+            rotary_encoder_isr_sw(instance_num);
             b_status = true;
         }
     }
@@ -230,154 +621,2366 @@ bool rotary_encoder_set_flags(uint8_t const instance_num,
     return b_status;
 }
 
-/// Was an interrupt handled for rotary encoder
-/// @param instance_num Instance number of encoder to check
-/// @return True if knob or switch event occurred, false otherwise
-bool rotary_encoder_check_event(uint8_t const instance_num)
+#if ROTARY_ENCODER_DELTA_INPUT
+/// Feed a relative change from any input, not only encoder flags
+/// Deltas add up until the next task call, which applies the total in one
+/// go through the same bounds, rollover, alert and event handling as a knob
+/// turn.  Safe to use from interrupts like rotary_encoder_set_flags(); with
+/// ROTARY_ENCODER_ATOMIC_FLAGS no delta is ever lost to a task call.
+/// @param instance_num Instance number of encoder to feed
+/// @param delta        Change of the knob value, positive to increment
+/// @param timestamp    Time of the input in ROTARY_ENCODER_TIMESTAMP() ticks,
+///                     0 if the source has none.  Used for the latency of
+///                     the event and the watchdog.
+/// @return True on success, false on error
+bool rotary_encoder_feed_delta(uint8_t const instance_num,
+                               int16_t const delta,
+                               uint32_t const timestamp)
 {
     bool b_status = false;
 
-    // Check and clear
+#if !ROTARY_ENCODER_EVENT_TIME
+    (void)timestamp;
+#endif
+
     if(rotary_encoder_initialized(instance_num))
     {
-        b_status |= instance_arr[instance_num].b_event_occured;
-        instance_arr[instance_num].b_event_occured = false;
+#if ROTARY_ENCODER_EVENT_TIME
+        // The source knows best when the input happened
+        if(rotary_encoder_isr_stamp(rotary_encoder_isr_bank(instance_num), instance_num) &&
+           (0u != timestamp))
+        {
+            rotary_encoder_isr_state[instance_num].event_time = timestamp;
+        }
+#endif
+
+#if ROTARY_ENCODER_ATOMIC_FLAGS
+        int32_t acc = atomic_load_explicit(&delta_acc_arr[instance_num].sum,
+                                           memory_order_relaxed);
+
+        // Retries only if another producer or the task got in between
+        while(!atomic_compare_exchange_weak_explicit(&delta_acc_arr[instance_num].sum, &acc,
+                                                     rotary_encoder_delta_sum(acc, delta),
+                                                     memory_order_relaxed,
+                                                     memory_order_relaxed))
+        {
+        }
+#else
+        delta_acc_arr[instance_num].sum =
+                rotary_encoder_delta_sum(delta_acc_arr[instance_num].sum, delta);
+#endif
+
+        // Flag after the add, so the task always finds the delta
+        rotary_encoder_isr_flag(&rotary_encoder_isr_bank(instance_num)->delta_flags,
+                                instance_num);
+
+        b_status = true;
     }
 
     return b_status;
 }
-
-/// Was an alert for rotary encoder set
-/// Right now this is only used to generate an alert of the value being stepped on
-/// @param instance_num Instance number of encoder to check
-/// @return True if knob or switch event occurred, false otherwise
-bool rotary_encoder_check_alert(uint8_t const instance_num)
+#endif
+
+#if ROTARY_ENCODER_GLITCH_FILTER
+/// Set the minimum time between knob edges
+/// Bouncing contacts make bursts of edges much closer together than any real
+/// turn.  Edges sooner than this after the last kept edge are dropped in the
+/// interrupt, before they cost the task anything.  Switch edges are not
+/// filtered.
+/// @param instance_num Instance number of encoder to set
+/// @param interval     Minimum ticks of ROTARY_ENCODER_TIMESTAMP(), 0 disables
+/// @return True on success, false on error
+bool rotary_encoder_set_min_edge_interval(uint8_t const instance_num,
+                                          uint32_t const interval)
 {
     bool b_status = false;
 
-    // Check and clear
     if(rotary_encoder_initialized(instance_num))
     {
-        b_status = instance_arr[instance_num].b_alert_occured;
-        instance_arr[instance_num].b_alert_occured = false;
+        rotary_encoder_isr_state[instance_num].min_edge_interval = interval;
+        b_status = true;
     }
 
     return b_status;
 }
 
-/// Flagged based task to handle interrupts regarding the encoder knob
-void rotary_encoder_task(void)
+/// Get the number of knob edges dropped by the glitch filter
+/// @param instance_num Instance number of encoder to get
+/// @return Edges dropped since init, 0 if not valid instance
+uint32_t rotary_encoder_get_glitch_count(uint8_t const instance_num)
 {
+    uint32_t count = 0;
+
+    if(rotary_encoder_initialized(instance_num))
+    {
+        count = rotary_encoder_isr_state[instance_num].glitch_count;
+    }
 
-    // Read what the interrupts set, then clear them
-    uint32_t const tmp_cw_flags = rotary_encoder_cw_flags;
-    uint32_t const tmp_ccw_flags = rotary_encoder_ccw_flags;
-    uint32_t const tmp_sw_flags = rotary_encoder_sw_flags;
+    return count;
+}
+#endif
+
+#if ROTARY_ENCODER_STORM_GUARD
+/// Set the functions the storm guard uses to mask and poll the encoders
+/// Instances the old hooks masked get their interrupt enabled again through
+/// the old hooks and go back to interrupts, the new hooks never saw them
+/// masked.  Call it from the thread that calls rotary_encoder_storm_poll().
+/// @param p_hooks Hooks to use, must stay valid, null stops the guard
+///                masking interrupts
+void rotary_encoder_set_storm_hooks(rotary_encoder_storm_hooks_t const * const p_hooks)
+{
+    if(p_hooks != p_storm_hooks)
+    {
+        for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+        {
+            rotary_encoder_storm_release(i);
+        }
+    }
 
-     rotary_encoder_cw_flags = 0;
-     rotary_encoder_ccw_flags = 0;
-     rotary_encoder_sw_flags = 0;
+    p_storm_hooks = p_hooks;
+}
 
-    // Loop through and make changes as needed
-    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+/// Stop polling an instance and enable its knob interrupt again
+/// @param instance_num Instance number, must be valid
+static void rotary_encoder_storm_release(uint8_t const instance_num)
+{
+    rotary_encoder_isr_state_t * const p_state = &rotary_encoder_isr_state[instance_num];
+
+    if(p_state->b_storm_polled)
+    {
+        p_state->b_storm_polled = false;
+
+        if((0 != p_storm_hooks) && (0 != p_storm_hooks->set_irq_enabled))
+        {
+            p_storm_hooks->set_irq_enabled(instance_num, true);
+        }
+    }
+}
+
+/// Set the edge rate that trips the storm guard
+/// More than max_edges knob edges within window ticks masks the knob
+/// interrupt and switches the instance to rotary_encoder_storm_poll().  It goes
+/// back to interrupts after a polled window with at most max_edges / 2 edges.
+/// @param instance_num Instance number of encoder to set
+/// @param max_edges    Most knob edges allowed in one window
+/// @param window       Window length in ticks of ROTARY_ENCODER_TIMESTAMP(),
+///                     0 disables the guard
+/// @return True on success, false on error
+bool rotary_encoder_set_storm_guard(uint8_t const instance_num,
+                                    uint16_t const max_edges,
+                                    uint32_t const window)
+{
+    bool b_status = false;
+
+    if(rotary_encoder_initialized(instance_num))
+    {
+        rotary_encoder_isr_state[instance_num].storm_max_edges = max_edges;
+        rotary_encoder_isr_state[instance_num].storm_window = window;
+        b_status = true;
+    }
+
+    return b_status;
+}
+
+/// Trip the storm guard of an instance, masking its knob interrupt
+/// Called by the interrupt functions, not meant to be called directly
+/// @param instance_num Instance number, must be valid
+void rotary_encoder_storm_trip(uint8_t const instance_num)
+{
+    rotary_encoder_isr_state_t * const p_state = &rotary_encoder_isr_state[instance_num];
+
+    if((0 != p_storm_hooks) && (0 != p_storm_hooks->set_irq_enabled))
     {
-        // Check if any flags set first
-        bool b_increment = (0 != ((1<<i) & tmp_cw_flags));
-        bool b_decrement = (0 != ((1<<i) & tmp_ccw_flags));
-        bool b_switch    = (0 != ((1<<i) & tmp_sw_flags));
+        p_storm_hooks->set_irq_enabled(instance_num, false);
+        p_state->b_storm_polled = true;
 
-        bool b_event = b_increment || b_decrement || b_switch;
+        if(UINT16_MAX != p_state->storm_count)
+        {
+            ++p_state->storm_count;
+        }
+    }
+}
 
-        if(b_event && rotary_encoder_initialized(i))
+/// Poll the knobs of instances the storm guard masked
+/// Call from a timer at a fixed rate, fast enough for the quickest real turn
+/// but well below the storm rate.  Polled turns go through the same path as
+/// interrupts, and the interrupt is enabled again once the rate drops.
+void rotary_encoder_storm_poll(void)
+{
+    for(uint8_t i = 0; (i < ROTARY_ENCODER_INSTANCES) && (0 != p_storm_hooks); i++)
+    {
+        rotary_encoder_isr_state_t * const p_state = &rotary_encoder_isr_state[i];
+
+        if(p_state->b_storm_polled)
         {
-            bool b_tmp_cw_pos = instance_arr[i].b_knob_cw_rot_positive;
+            uint32_t const now = (uint32_t)ROTARY_ENCODER_TIMESTAMP();
 
-            // Flags set, handle them
-            if(b_increment)
+            // Check the window that just ended before counting new edges
+            if(ROTARY_ENCODER_TIMESTAMP_DIFF(now, p_state->storm_window_start) >=
+               p_state->storm_window)
             {
-                b_tmp_cw_pos ?
-                        rotary_encoder_inc_knob_value(i) :
-                        rotary_encoder_dec_knob_value(i);
+                if(p_state->storm_edges <= (p_state->storm_max_edges / 2u))
+                {
+                    rotary_encoder_storm_release(i);
+                }
+
+                p_state->storm_window_start = now;
+                p_state->storm_edges = 0;
             }
 
-            if(b_decrement)
+            uint8_t const flag = (0 != p_storm_hooks->poll_knob) ?
+                                 p_storm_hooks->poll_knob(i) : 0u;
+
+            if(ROTARY_ENCODER_FLAG_CW == flag)
             {
-                    b_tmp_cw_pos ?
-                            rotary_encoder_dec_knob_value(i) :
-                            rotary_encoder_inc_knob_value(i);
+                rotary_encoder_isr_cw(i);
             }
 
-            if(b_switch)
+            if(ROTARY_ENCODER_FLAG_CCW == flag)
             {
-                rotary_encoder_tog_switch_value(i);
+                rotary_encoder_isr_ccw(i);
             }
-
-            instance_arr[i].b_event_occured = true;
         }
     }
+}
+
+/// Get the number of times the storm guard tripped
+/// @param instance_num Instance number of encoder to get
+/// @return Trips since init, 0 if not valid instance
+uint16_t rotary_encoder_get_storm_count(uint8_t const instance_num)
+{
+    uint16_t count = 0;
+
+    if(rotary_encoder_initialized(instance_num))
+    {
+        count = rotary_encoder_isr_state[instance_num].storm_count;
+    }
 
+    return count;
 }
 
-/// Check if bounds are enabled for knob values, and force if so
-/// @param instance Instance number to track in module
-/// @return True if encoder was stepped on or rolled over, false otherwise
-static bool rotary_encoder_force_bounds(uint8_t const instance_num)
+/// Check if the storm guard is polling an instance instead of interrupts
+/// @param instance_num Instance number of encoder to get
+/// @return True while polled, false otherwise
+bool rotary_encoder_get_storm_polled(uint8_t const instance_num)
 {
     bool b_status = false;
 
-    int16_t value = instance_arr[instance_num].knob_value;
+    if(rotary_encoder_initialized(instance_num))
+    {
+        b_status = rotary_encoder_isr_state[instance_num].b_storm_polled;
+    }
 
-    bool b_above_max = (value > instance_arr[instance_num].knob_max_value);
-    bool b_below_min = (value < instance_arr[instance_num].knob_min_value);
+    return b_status;
+}
+#endif
+
+#if ROTARY_ENCODER_NOTIFY_THRESHOLD
+/// Set the smallest knob move that is notified
+/// Moves are added up from the value at the last notification.  Until they
+/// reach the threshold the knob value changes, but the event flag is not set
+/// and the change is not published to frames or pass hooks.  Switch changes
+/// are always notified.
+/// @param instance_num Instance number of encoder to set
+/// @param threshold    Smallest move notified, 0 or 1 to notify every move
+/// @return True on success, false on error
+bool rotary_encoder_set_notify_threshold(uint8_t const instance_num,
+                                         uint16_t const threshold)
+{
+    bool b_status = false;
 
-    if(b_above_max || b_below_min)
+    if(rotary_encoder_initialized(instance_num))
     {
-        // Should the value be stepped on?
-        if(instance_arr[instance_num].b_knob_allow_step_on)
-        {
+        rotary_encoder_write_begin(instance_num);
+        instance_arr[instance_num].notify_threshold = threshold;
+        instance_arr[instance_num].notified_value = instance_arr[instance_num].knob_value;
+        rotary_encoder_write_end(instance_num);
+
+        b_status = true;
+    }
+
+    return b_status;
+}
+#endif
+
+#if ROTARY_ENCODER_REVERSAL_FILTER
+/// Set the direction reversal filter
+/// At high speed contact bounce can add a single step the wrong way.  While
+/// the last two steps were less than dwell apart, a change of direction is
+/// only taken after events opposite events in a row, or if it comes at least
+/// dwell after the last step.  Timing comes from the interrupt timestamps.
+/// @param instance_num Instance number of encoder to set
+/// @param events       Opposite events in a row to take a change, 0 disables
+/// @param dwell        Ticks of ROTARY_ENCODER_TIMESTAMP()
+/// @return True on success, false on error
+bool rotary_encoder_set_reversal_filter(uint8_t const instance_num,
+                                        uint8_t const events,
+                                        uint32_t const dwell)
+{
+    bool b_status = false;
+
+    if(rotary_encoder_initialized(instance_num))
+    {
+        rotary_encoder_write_begin(instance_num);
+        instance_arr[instance_num].reversal_events = events;
+        instance_arr[instance_num].reversal_dwell = dwell;
+        instance_arr[instance_num].reversal_count = 0;
+        rotary_encoder_write_end(instance_num);
+
+        b_status = true;
+    }
+
+    return b_status;
+}
+#endif
+
+#if ROTARY_ENCODER_INERTIA
+/// Set the inertia of the knob
+/// After a turn at least min_velocity fast, once the next step is overdue the
+/// value keeps stepping on its own in the same direction.  Every task call the
+/// velocity is multiplied by decay / 256 until it is too slow to matter.  A
+/// turn the other way or a switch press stops it at once.  Velocity is counted
+/// in task calls, so call the task at a steady rate.
+/// @param instance_num Instance number of encoder to set
+/// @param min_velocity Slowest turn that coasts, 1/256 steps per task call,
+///                     256 is a step every call, 0 disables
+/// @param decay        Velocity kept per task call, out of 256
+/// @return True on success, false on error
+bool rotary_encoder_set_inertia(uint8_t const instance_num,
+                                uint16_t const min_velocity,
+                                uint8_t const decay)
+{
+    bool b_status = false;
 
-            value = b_above_max ?
-                    instance_arr[instance_num].knob_max_value:
-                    value;
+    if(rotary_encoder_initialized(instance_num))
+    {
+        rotary_encoder_write_begin(instance_num);
+        instance_arr[instance_num].coast_min_velocity = min_velocity;
+        instance_arr[instance_num].coast_decay = decay;
+        rotary_encoder_stop_coast(instance_num);
+        rotary_encoder_write_end(instance_num);
 
-            value = b_below_min ?
-                    instance_arr[instance_num].knob_min_value:
-                    value;
+        b_status = true;
+    }
 
+    return b_status;
+}
 
-            instance_arr[instance_num].knob_value = value;
+/// Check if the knob value is stepping on its own after a flick
+/// @param instance_num Instance number of encoder to check
+/// @return True if coasting, false if not or not valid instance
+bool rotary_encoder_get_coasting(uint8_t const instance_num)
+{
+    bool b_status = false;
 
-        }
-        else
+    if(rotary_encoder_initialized(instance_num))
+    {
+        b_status = instance_arr[instance_num].b_coasting;
+    }
+
+    return b_status;
+}
+#endif
+
+#if ROTARY_ENCODER_SLEW
+/// Set how fast the output value follows the knob value
+/// Each task call the output value moves at most rate toward the knob value,
+/// the straight way even after a rollover.  Only instances still ramping are
+/// looked at by the task.
+/// @param instance_num Instance number of encoder to set
+/// @param rate         Max output change per task call, 0 to follow at once
+/// @return True on success, false on error
+bool rotary_encoder_set_slew_rate(uint8_t const instance_num,
+                                  uint16_t const rate)
+{
+    bool b_status = false;
+
+    if(rotary_encoder_initialized(instance_num))
+    {
+        rotary_encoder_write_begin(instance_num);
+        instance_arr[instance_num].slew_rate = rate;
+        rotary_encoder_write_end(instance_num);
+
+        b_status = true;
+    }
+
+    return b_status;
+}
+
+/// Get the slew rate limited output value
+/// Safe to call from any number of threads while rotary_encoder_task() runs
+/// @param instance_num Instance number of encoder to get
+/// @return The output value, 0 if not valid instance
+int16_t rotary_encoder_get_output_value(uint8_t const instance_num)
+{
+    int16_t status = 0;
+
+    if(rotary_encoder_initialized(instance_num))
+    {
+        rotary_encoder_snapshot_t snapshot;
+
+        rotary_encoder_read(instance_num, &snapshot);
+        status = snapshot.output_value;
+    }
+
+    return status;
+}
+#endif
+
+#if ROTARY_ENCODER_PARAMS
+/// Bind an instance to a parameter, for one encoder editing pages of them
+/// The parameter bounds replace those of the instance and its value is kept
+/// up to date by the task.  Binding another parameter is constant time and
+/// leaves the old one with its last value.  Without takeover the knob value
+/// jumps to the parameter value.  With takeover the knob value is kept, for
+/// knobs that show their position, and the parameter is only picked up once
+/// the knob value reaches or crosses it.  Read bound parameters from the task
+/// thread only.
+/// @param instance_num Instance number of encoder to bind
+/// @param p_param      Parameter to bind, null to unbind and keep the value
+/// @param b_takeover   True to keep the knob value until it meets the parameter
+/// @return True on success, false on error
+bool rotary_encoder_bind_param(uint8_t const instance_num,
+                               rotary_encoder_param_t * const p_param,
+                               bool const b_takeover)
+{
+    bool b_status = false;
+
+    if(rotary_encoder_initialized(instance_num) &&
+       ((0 == p_param) || (p_param->min_value <= p_param->max_value)))
+    {
+        rotary_encoder_t * const p_inst = &instance_arr[instance_num];
+
+        rotary_encoder_write_begin(instance_num);
+
+        p_inst->p_param = p_param;
+
+        if(0 != p_param)
         {
+            rotary_encoder_set_bounds(instance_num, p_param->min_value,
+                                      p_param->max_value, p_param->b_step_on);
+
+            if(!b_takeover)
+            {
+                p_inst->knob_value = p_param->value;
+            }
 
-            value = b_above_max ?
-                    instance_arr[instance_num].knob_min_value:
-                    value;
+            // A page switch is not a turn, clamp without wrapping or alerting
+            if(p_inst->knob_value > p_param->max_value)
+            {
+                p_inst->knob_value = p_param->max_value;
+            }
 
-            value = b_below_min ?
-                    instance_arr[instance_num].knob_max_value:
-                    value;
+            if(p_inst->knob_value < p_param->min_value)
+            {
+                p_inst->knob_value = p_param->min_value;
+            }
 
+            p_inst->param_side = (p_inst->knob_value > p_param->value) ? 1 :
+                                 (p_inst->knob_value < p_param->value) ? -1 : 0;
+            p_inst->b_param_picked_up = (0 == p_inst->param_side);
         }
 
-        instance_arr[instance_num].knob_value = value;
-    }
+        rotary_encoder_write_end(instance_num);
 
-    b_status =
-            instance_arr[instance_num].b_alert_occured =
-            (b_above_max || b_below_min);
+        b_status = true;
+    }
 
     return b_status;
 }
 
-/// Check if the instance is initialized
-/// @param instance Instance number to track in module
-/// @return True if encoder was initialized, false otherwise
-static bool rotary_encoder_initialized(uint8_t const instance_num)
+/// Check if the knob value has picked up the bound parameter
+/// @param instance_num Instance number of encoder to check
+/// @return True if picked up, false if waiting for takeover or not bound
+bool rotary_encoder_get_param_picked_up(uint8_t const instance_num)
 {
-    bool b_status = (ROTARY_ENCODER_INSTANCES > instance_num);
-    b_status &= instance_arr[instance_num].b_initialized;
+    bool b_status = false;
+
+    if(rotary_encoder_initialized(instance_num))
+    {
+        b_status = (0 != instance_arr[instance_num].p_param) &&
+                   instance_arr[instance_num].b_param_picked_up;
+    }
 
     return b_status;
 }
+#endif
+
+/// Assign an instance to a bank
+/// Each bank has its own interrupt flags and task, so interrupts and tasks on
+/// different cores never touch the same flags.  Flags the instance has
+/// pending move to the new bank with it.  Do this before enabling the instance
+/// interrupts or with them masked, an edge racing the move can be left behind.
+/// @param instance_num Instance number to assign
+/// @param bank_num     Bank number, less than ROTARY_ENCODER_BANKS
+/// @return True on success, false on error
+bool rotary_encoder_set_bank(uint8_t const instance_num,
+                             uint8_t const bank_num)
+{
+    bool b_status = false;
+
+    if((ROTARY_ENCODER_INSTANCES > instance_num) &&
+       (ROTARY_ENCODER_BANKS > bank_num))
+    {
+        uint32_t const mask = (1u << instance_num);
+
+#if ROTARY_ENCODER_INERTIA
+        // Inertia is timed by the bank task, start over in the new bank
+        rotary_encoder_stop_coast(instance_num);
+#endif
+
+#if ROTARY_ENCODER_SLEW
+        // Keep ramping in the new bank
+        if(0u != (bank_arr[rotary_encoder_instance_bank[instance_num]].ramp_flags & mask))
+        {
+            bank_arr[rotary_encoder_instance_bank[instance_num]].ramp_flags &= ~mask;
+            bank_arr[bank_num].ramp_flags |= mask;
+        }
+#endif
+
+        uint8_t const old_bank_num = rotary_encoder_instance_bank[instance_num];
+        rotary_encoder_bank_t * const p_old = &bank_arr[old_bank_num];
+        rotary_encoder_bank_t * const p_new = &bank_arr[bank_num];
+
+        p_old->member_flags &= ~mask;
+        p_new->member_flags |= mask;
+        rotary_encoder_instance_bank[instance_num] = bank_num;
+
+#if ROTARY_ENCODER_BANKS > 1u
+        if(old_bank_num != bank_num)
+        {
+            // Work collected but not done yet, the old bank task never looks again
+            p_new->pending_cw_flags |= (p_old->pending_cw_flags & mask);
+            p_new->pending_ccw_flags |= (p_old->pending_ccw_flags & mask);
+            p_new->pending_sw_flags |= (p_old->pending_sw_flags & mask);
+            p_old->pending_cw_flags &= ~mask;
+            p_old->pending_ccw_flags &= ~mask;
+            p_old->pending_sw_flags &= ~mask;
+#if ROTARY_ENCODER_DELTA_INPUT
+            p_new->pending_delta_flags |= (p_old->pending_delta_flags & mask);
+            p_old->pending_delta_flags &= ~mask;
+#endif
+
+            // Flags set by interrupts the old bank task has not collected
+            rotary_encoder_move_flag(&rotary_encoder_bank_flags[old_bank_num].cw_flags,
+                                     &rotary_encoder_bank_flags[bank_num].cw_flags,
+                                     instance_num);
+            rotary_encoder_move_flag(&rotary_encoder_bank_flags[old_bank_num].ccw_flags,
+                                     &rotary_encoder_bank_flags[bank_num].ccw_flags,
+                                     instance_num);
+            rotary_encoder_move_flag(&rotary_encoder_bank_flags[old_bank_num].sw_flags,
+                                     &rotary_encoder_bank_flags[bank_num].sw_flags,
+                                     instance_num);
+#if ROTARY_ENCODER_DELTA_INPUT
+            rotary_encoder_move_flag(&rotary_encoder_bank_flags[old_bank_num].delta_flags,
+                                     &rotary_encoder_bank_flags[bank_num].delta_flags,
+                                     instance_num);
+#endif
+#if ROTARY_ENCODER_EVENT_TIME
+            rotary_encoder_move_flag(&rotary_encoder_bank_flags[old_bank_num].held_flags,
+                                     &rotary_encoder_bank_flags[bank_num].held_flags,
+                                     instance_num);
+#endif
+        }
+#endif
+
+        b_status = true;
+    }
+
+    return b_status;
+}
+
+/// Get the bank an instance is assigned to
+/// @param instance_num Instance number to get
+/// @return The bank number, 0 if not valid instance
+uint8_t rotary_encoder_get_bank(uint8_t const instance_num)
+{
+    uint8_t bank_num = 0;
+
+    if(ROTARY_ENCODER_INSTANCES > instance_num)
+    {
+        bank_num = rotary_encoder_instance_bank[instance_num];
+    }
+
+    return bank_num;
+}
+
+#if ROTARY_ENCODER_FRAMES
+/// Get the last frame published by the task, wait free
+/// The frame holds every instance as of the end of one task call.  Its
+/// contents stay untouched until ROTARY_ENCODER_FRAMES - 1 more frames are
+/// published, so copy what is needed before then.  Nothing tells a reader
+/// that took longer than that, use rotary_encoder_copy_frame() if it can.
+/// Compare frame_num against a later call to find out how many frames were
+/// published since.
+/// @return Pointer to the front frame, never null
+rotary_encoder_frame_t const * rotary_encoder_get_frame(void)
+{
+    return atomic_load_explicit(&p_front_frame, memory_order_acquire);
+}
+
+/// Copy the last frame published by the task, never torn
+/// Unlike reading through rotary_encoder_get_frame(), a reader that is slow or
+/// preempted while the task fills the same frame again retries the copy, so
+/// this works with any ROTARY_ENCODER_FRAMES and any reader speed.
+/// @param p_frame Where to copy the frame
+/// @return True on success, false if p_frame is null
+bool rotary_encoder_copy_frame(rotary_encoder_frame_t * const p_frame)
+{
+    bool b_status = false;
+
+    if(0 != p_frame)
+    {
+        unsigned seq_start;
+        unsigned seq_end;
+        uint8_t frame;
+
+        do
+        {
+            rotary_encoder_frame_t const * const p_front =
+                    atomic_load_explicit(&p_front_frame, memory_order_acquire);
+
+            frame = (uint8_t)(p_front - &frame_arr[0]);
+
+            seq_start = atomic_load_explicit(&frame_seq_arr[frame], memory_order_acquire);
+
+            // Only the atomic words, the task may be writing the frame itself
+            atomic_uint const * const p_word = &frame_word_arr[frame][0];
+
+            p_frame->frame_num = atomic_load_explicit(&p_word[0], memory_order_relaxed);
+
+            for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+            {
+                rotary_encoder_unpack(atomic_load_explicit(&p_word[1u + i],
+                                                           memory_order_relaxed),
+                                      &p_frame->instance[i]);
+
+#if ROTARY_ENCODER_SLEW
+                p_frame->instance[i].output_value =
+                        (int16_t)(uint16_t)atomic_load_explicit(
+                                &p_word[1u + ROTARY_ENCODER_INSTANCES + i],
+                                memory_order_relaxed);
+#endif
+            }
+
+            atomic_thread_fence(memory_order_acquire);
+            seq_end = atomic_load_explicit(&frame_seq_arr[frame], memory_order_relaxed);
+
+        // Odd means the task was filling it, a change means it was refilled
+        } while((0u != (seq_start & 1u)) || (seq_start != seq_end));
+
+        b_status = true;
+    }
+
+    return b_status;
+}
+#endif
+
+#if ROTARY_ENCODER_WATCHDOG
+/// Set the stale work watchdog
+/// Call before starting rotary_encoder_watchdog_check(), not while it runs.
+/// Also resets the max pending age.
+/// @param threshold Work pending longer than this many ROTARY_ENCODER_TIMESTAMP()
+///                  ticks calls the hook, 0 disables the hook
+/// @param hook      Called with the instance and age of its pending work, once
+///                  per instance each time it gets too old, or null
+void rotary_encoder_set_watchdog(uint32_t const threshold,
+                                 rotary_encoder_watchdog_hook_t const hook)
+{
+    watchdog_threshold = threshold;
+    watchdog_hook = hook;
+    watchdog_fired_flags = 0;
+    watchdog_max_age = 0;
+}
+
+/// Check how long work has waited for the task to handle it
+/// Work counts from its first interrupt until the task handles it, including
+/// time put off by rotary_encoder_task_budget().  Call from a timer, or any
+/// one thread or interrupt, more often than the threshold.  It never changes
+/// what the task sees, only reads the flags.
+/// @return Age of the oldest pending work in ROTARY_ENCODER_TIMESTAMP() ticks,
+///         0 if none
+uint32_t rotary_encoder_watchdog_check(void)
+{
+    uint32_t const now = (uint32_t)ROTARY_ENCODER_TIMESTAMP();
+    uint32_t oldest = 0;
+
+    for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+    {
+        uint32_t const pending_flags = rotary_encoder_isr_pending(&rotary_encoder_bank_flags[b]);
+
+        for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+        {
+            uint32_t const mask = (1u << i);
+
+            if((0u != (pending_flags & mask)) &&
+               (b == rotary_encoder_instance_bank[i]))
+            {
+                uint32_t const age =
+                        ROTARY_ENCODER_TIMESTAMP_DIFF(now, rotary_encoder_isr_state[i].event_time);
+
+                oldest = (age > oldest) ? age : oldest;
+
+                if((0u != watchdog_threshold) &&
+                   (age > watchdog_threshold) &&
+                   (0u == (watchdog_fired_flags & mask)))
+                {
+                    watchdog_fired_flags |= mask;
+
+                    if(0 != watchdog_hook)
+                    {
+                        watchdog_hook(i, age);
+                    }
+                }
+            }
+            else if(b == rotary_encoder_instance_bank[i])
+            {
+                // Taken by the task, report the next work that gets too old
+                watchdog_fired_flags &= ~mask;
+            }
+        }
+    }
+
+    watchdog_max_age = (oldest > watchdog_max_age) ? oldest : watchdog_max_age;
+
+    return oldest;
+}
+
+/// Get the oldest pending work rotary_encoder_watchdog_check() has seen
+/// @return Age in ROTARY_ENCODER_TIMESTAMP() ticks since rotary_encoder_set_watchdog()
+uint32_t rotary_encoder_get_max_pending_age(void)
+{
+    return watchdog_max_age;
+}
+#endif
+
+#if ROTARY_ENCODER_COST_BUDGET
+/// Set the budget for handling one instance event
+/// Call before starting the task, not while it runs.  Also resets the max cost.
+/// @param budget Events taking longer than this many ROTARY_ENCODER_TIMESTAMP()
+///               ticks call the hook, 0 disables the hook
+/// @param hook   Called from the task with the instance and cost, or null
+void rotary_encoder_set_cost_budget(uint32_t const budget,
+                                    rotary_encoder_cost_hook_t const hook)
+{
+    cost_budget = budget;
+    cost_hook = hook;
+
+    for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+    {
+        bank_arr[b].cost_max = 0;
+    }
+}
+
+/// Get the longest time handling one instance event took
+/// @return Cost in ROTARY_ENCODER_TIMESTAMP() ticks since rotary_encoder_set_cost_budget()
+uint32_t rotary_encoder_get_max_cost(void)
+{
+    uint32_t cost = 0;
+
+    for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+    {
+        cost = (bank_arr[b].cost_max > cost) ? bank_arr[b].cost_max : cost;
+    }
+
+    return cost;
+}
+#endif
+
+#if ROTARY_ENCODER_SELF_CHECK
+/// Check the state every instance must always be in
+/// Call between task calls, from a test loop or a debug build.
+/// @return True if every instance is consistent, false otherwise
+bool rotary_encoder_check_invariants(void)
+{
+    bool b_status = true;
+    uint32_t member_flags = 0;
+
+    for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+    {
+        // Every instance is in exactly one bank
+        b_status = b_status && (0u == (member_flags & bank_arr[b].member_flags));
+        member_flags |= bank_arr[b].member_flags;
+    }
+
+    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+    {
+        rotary_encoder_t const * const p_inst = &instance_arr[i];
+        uint8_t const bank_num = rotary_encoder_instance_bank[i];
+
+        b_status = b_status &&
+                   (ROTARY_ENCODER_BANKS > bank_num) &&
+                   (0u != (bank_arr[bank_num].member_flags & (1u << i)));
+
+        if(p_inst->b_initialized)
+        {
+            b_status = b_status &&
+                       (p_inst->knob_min_value <= p_inst->knob_max_value) &&
+                       (p_inst->knob_min_value <= p_inst->knob_value) &&
+                       (p_inst->knob_max_value >= p_inst->knob_value);
+
+#if ROTARY_ENCODER_DELTA_INPUT
+            b_status = b_status &&
+                       (p_inst->knob_range ==
+                        ((int32_t)p_inst->knob_max_value - p_inst->knob_min_value + 1));
+#endif
+        }
+    }
+
+    return b_status;
+}
+#endif
+
+#if ROTARY_ENCODER_PASS_HOOKS
+/// Add a function called at the end of each task call that changed something
+/// Hooks run in the task thread, after frames are published, with a mask of
+/// the instances changed by the call or by setters since the last call.
+/// @param hook Function to call, adding the same hook twice is allowed
+/// @return True on success, false if null or all hook slots are in use
+bool rotary_encoder_add_pass_hook(rotary_encoder_pass_hook_t const hook)
+{
+    bool b_status = false;
+
+    for(uint8_t i = 0; (i < ROTARY_ENCODER_PASS_HOOKS) && !b_status; i++)
+    {
+        if((0 != hook) && (0 == pass_hook_arr[i]))
+        {
+            pass_hook_arr[i] = hook;
+            b_status = true;
+        }
+    }
+
+    return b_status;
+}
+
+/// Remove a function added by rotary_encoder_add_pass_hook()
+/// @param hook Function to remove
+/// @return True on success, false if the hook was not added
+bool rotary_encoder_remove_pass_hook(rotary_encoder_pass_hook_t const hook)
+{
+    bool b_status = false;
+
+    for(uint8_t i = 0; (i < ROTARY_ENCODER_PASS_HOOKS) && !b_status; i++)
+    {
+        if((0 != hook) && (hook == pass_hook_arr[i]))
+        {
+            pass_hook_arr[i] = 0;
+            b_status = true;
+        }
+    }
+
+    return b_status;
+}
+#endif
+
+/// Was an interrupt handled for rotary encoder
+/// With ROTARY_ENCODER_MULTI_READER, call this only from the thread that runs
+/// rotary_encoder_task(); other threads use rotary_encoder_get_snapshot()
+/// @param instance_num Instance number of encoder to check
+/// @return True if knob or switch event occurred, false otherwise
+bool rotary_encoder_check_event(uint8_t const instance_num)
+{
+    bool b_status = false;
+
+    // Check and clear
+    if(rotary_encoder_initialized(instance_num))
+    {
+        rotary_encoder_write_begin(instance_num);
+        b_status |= instance_arr[instance_num].b_event_occured;
+        instance_arr[instance_num].b_event_occured = false;
+        rotary_encoder_write_finish(instance_num, false);
+
+#if ROTARY_ENCODER_LATENCY
+        if(b_status)
+        {
+            rotary_encoder_latency_sample(instance_num);
+        }
+#endif
+    }
+
+    return b_status;
+}
+
+/// Was an alert for rotary encoder set
+/// Right now this is only used to generate an alert of the value being stepped on
+/// or rolled over.  It is kept until read, even if later steps are in bounds.
+/// @param instance_num Instance number of encoder to check
+/// @return True if knob or switch event occurred, false otherwise
+bool rotary_encoder_check_alert(uint8_t const instance_num)
+{
+    bool b_status = false;
+
+    // Check and clear
+    if(rotary_encoder_initialized(instance_num))
+    {
+        rotary_encoder_write_begin(instance_num);
+        b_status = instance_arr[instance_num].b_alert_occured;
+        instance_arr[instance_num].b_alert_occured = false;
+        rotary_encoder_write_finish(instance_num, false);
+    }
+
+    return b_status;
+}
+
+#if ROTARY_ENCODER_ALERT_BITS
+/// Read and clear the alerts of every instance at once
+/// Call from the thread that runs rotary_encoder_task(), like
+/// rotary_encoder_check_alert(), which this also clears.
+/// @param p_bits_arr  ROTARY_ENCODER_INSTANCES entries to get the
+///                    ROTARY_ENCODER_ALERT bits of each instance, or null
+/// @param p_count_arr ROTARY_ENCODER_INSTANCES entries to get the number of
+///                    bounds hit by each instance, or null
+/// @return Bit mask of the instances with alerts
+uint32_t rotary_encoder_take_alerts(uint8_t * const p_bits_arr,
+                                    uint16_t * const p_count_arr)
+{
+    uint32_t alert_flags = 0;
+
+    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+    {
+        rotary_encoder_t * const p_inst = &instance_arr[i];
+
+        if(0u != p_inst->alert_bits)
+        {
+            alert_flags |= (1u << i);
+        }
+
+        if(0 != p_bits_arr)
+        {
+            p_bits_arr[i] = p_inst->alert_bits;
+        }
+
+        if(0 != p_count_arr)
+        {
+            p_count_arr[i] = p_inst->alert_count;
+        }
+
+        rotary_encoder_write_begin(i);
+        p_inst->alert_bits = 0;
+        p_inst->alert_count = 0;
+        p_inst->b_alert_occured = false;
+        rotary_encoder_write_finish(i, false);
+    }
+
+    return alert_flags;
+}
+#endif
+
+#if ROTARY_ENCODER_LATENCY
+/// Get the latency from the first interrupt of an event to the
+/// rotary_encoder_check_event() call that returned it
+/// Latencies are counted in power of two buckets, so the result is the top of
+/// the bucket the percentile falls in, at most twice the real value.
+/// @param percentile Percent of events at or below the result, 1 to 100,
+///                   above 100 counts as 100
+/// @return Latency in ROTARY_ENCODER_TIMESTAMP() ticks, 0 if none measured
+uint32_t rotary_encoder_get_latency(uint8_t const percentile)
+{
+    uint64_t const percent = (100u < percentile) ? 100u : percentile;
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint32_t latency = 0;
+
+    for(uint8_t n = 0; n < 32u; n++)
+    {
+        for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+        {
+            total += bank_arr[b].latency_hist[n];
+        }
+    }
+
+    // Rank of the event the percentile falls on, rounded up
+    uint64_t const rank = ((total * percent) + 99u) / 100u;
+
+    for(uint8_t n = 0; (n < 32u) && (0u != rank) && (count < rank); n++)
+    {
+        for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+        {
+            count += bank_arr[b].latency_hist[n];
+        }
+
+        latency = (uint32_t)(((uint64_t)2u << n) - 1u);
+    }
+
+    return latency;
+}
+
+/// Get the longest latency measured, see rotary_encoder_get_latency()
+/// @return Latency in ROTARY_ENCODER_TIMESTAMP() ticks, 0 if none measured
+uint32_t rotary_encoder_get_latency_max(void)
+{
+    uint32_t latency = 0;
+
+    for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+    {
+        latency = (bank_arr[b].latency_max > latency) ? bank_arr[b].latency_max : latency;
+    }
+
+    return latency;
+}
+
+/// Forget every latency measured so far
+void rotary_encoder_reset_latency(void)
+{
+    for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+    {
+        bank_arr[b].latency_max = 0;
+
+        for(uint8_t n = 0; n < 32u; n++)
+        {
+            bank_arr[b].latency_hist[n] = 0;
+        }
+    }
+}
+#endif
+
+/// Flagged based task to handle interrupts regarding the encoder knob
+/// Handles every instance with pending flags, including any work left over
+/// by rotary_encoder_task_budget()
+void rotary_encoder_task(void)
+{
+    for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+    {
+        rotary_encoder_run_bank(b);
+    }
+
+    rotary_encoder_publish();
+}
+
+/// Flagged based task for the instances of one bank
+/// Meant to run on the core that handles the bank interrupts.  Only the
+/// single bank build publishes here, with more banks call
+/// rotary_encoder_publish() from one thread after the bank tasks.
+/// @param bank_num Bank number to handle
+/// @return True on success, false if not a valid bank
+bool rotary_encoder_task_bank(uint8_t const bank_num)
+{
+    bool b_status = false;
+
+    if(ROTARY_ENCODER_BANKS > bank_num)
+    {
+        rotary_encoder_run_bank(bank_num);
+
+#if ROTARY_ENCODER_BANKS == 1u
+        rotary_encoder_publish();
+#endif
+
+        b_status = true;
+    }
+
+    return b_status;
+}
+
+#if ROTARY_ENCODER_TASK_BUDGET
+/// Flagged based task with a bounded amount of work per call
+/// Handles at most max_instances instances with pending flags, round robin.
+/// The next call resumes after the last instance handled, so every pending
+/// instance is handled within ROTARY_ENCODER_INSTANCES / max_instances calls
+/// (rounded up) no matter how busy the other instances are.
+/// @param max_instances Max number of pending instances to handle this call
+/// @return True if pending work remains for a later call, false otherwise
+bool rotary_encoder_task_budget(uint8_t const max_instances)
+{
+    uint8_t handled = 0;
+    uint8_t i = task_cursor;
+    bool b_pending = false;
+
+    for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+    {
+        rotary_encoder_collect_flags(b);
+    }
+
+    // Look at each instance at most once per call, starting at the cursor
+    for(uint8_t n = 0;
+        (n < ROTARY_ENCODER_INSTANCES) && (handled < max_instances);
+        n++)
+    {
+        if(rotary_encoder_pending(i))
+        {
+            rotary_encoder_process(i);
+            ++handled;
+
+            // Resume after the last instance handled
+            task_cursor = ((i + 1u) < ROTARY_ENCODER_INSTANCES) ? (i + 1u) : 0u;
+        }
+
+        i = ((i + 1u) < ROTARY_ENCODER_INSTANCES) ? (i + 1u) : 0u;
+    }
+
+    for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+    {
+        rotary_encoder_tick(b);
+    }
+
+    rotary_encoder_publish();
+
+    for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+    {
+        b_pending |= (0u != (bank_arr[b].pending_cw_flags |
+                             bank_arr[b].pending_ccw_flags |
+                             bank_arr[b].pending_sw_flags));
+#if ROTARY_ENCODER_DELTA_INPUT
+        b_pending |= (0u != bank_arr[b].pending_delta_flags);
+#endif
+    }
+
+    return b_pending;
+}
+#endif
+
+/// Set the knob value, stepped on or rolled over if outside the bounds
+/// @param instance Instance number to track in module
+/// @param value    New value, may be one past a bound or any int16_t value
+/// @return True if encoder was stepped on or rolled over, false otherwise
+static bool rotary_encoder_force_bounds(uint8_t const instance_num,
+                                        int32_t const value)
+{
+    bool b_status = false;
+
+    int32_t const max_value = instance_arr[instance_num].knob_max_value;
+    int32_t const min_value = instance_arr[instance_num].knob_min_value;
+
+    bool b_above_max = (value > max_value);
+    bool b_below_min = (value < min_value);
+
+    // Kept in 32 bits until here, so one past INT16_MAX does not wrap first
+    int32_t new_value = value;
+
+    if(b_above_max || b_below_min)
+    {
+        // Should the value be stepped on?
+        if(instance_arr[instance_num].b_knob_allow_step_on)
+        {
+            new_value = b_above_max ? max_value : min_value;
+        }
+        else
+        {
+            new_value = b_above_max ? min_value : max_value;
+        }
+
+        rotary_encoder_alert(instance_num, b_above_max,
+                             instance_arr[instance_num].b_knob_allow_step_on);
+    }
+
+    instance_arr[instance_num].knob_value = (int16_t)new_value;
+
+    b_status = (b_above_max || b_below_min);
+
+    return b_status;
+}
+
+/// Record that an instance hit a bound, kept until the alert is read
+/// @param instance_num Instance number that hit a bound
+/// @param b_max        True for the max bound, false for the min bound
+/// @param b_step_on    True if stepped on the bound, false if rolled over
+static void rotary_encoder_alert(uint8_t const instance_num,
+                                 bool const b_max,
+                                 bool const b_step_on)
+{
+    rotary_encoder_t * const p_inst = &instance_arr[instance_num];
+
+    p_inst->b_alert_occured = true;
+
+#if ROTARY_ENCODER_ALERT_BITS
+    p_inst->alert_bits |= b_step_on ?
+                          (b_max ? ROTARY_ENCODER_ALERT_CLAMP_MAX : ROTARY_ENCODER_ALERT_CLAMP_MIN) :
+                          (b_max ? ROTARY_ENCODER_ALERT_WRAP_MAX : ROTARY_ENCODER_ALERT_WRAP_MIN);
+
+    if(UINT16_MAX != p_inst->alert_count)
+    {
+        ++p_inst->alert_count;
+    }
+#else
+    (void)b_max;
+    (void)b_step_on;
+#endif
+}
+
+/// Check if the instance is initialized
+/// @param instance Instance number to track in module
+/// @return True if encoder was initialized, false otherwise
+static bool rotary_encoder_initialized(uint8_t const instance_num)
+{
+    return (ROTARY_ENCODER_INSTANCES > instance_num) &&
+           instance_arr[instance_num].b_initialized;
+}
+
+/// Move what the interrupts set into the pending flags, then clear them
+/// @param bank_num Bank number to collect the flags of
+static void rotary_encoder_collect_flags(uint8_t const bank_num)
+{
+    rotary_encoder_bank_flags_t * const p_flags =
+            &rotary_encoder_bank_flags[bank_num];
+    rotary_encoder_bank_t * const p_bank = &bank_arr[bank_num];
+
+#if ROTARY_ENCODER_EVENT_TIME
+    // Held before the flags are taken, so interrupts never see the instance
+    // idle in between and stamp a newer time over the work being taken
+    rotary_encoder_set_held(p_flags, rotary_encoder_isr_pending(p_flags));
+#endif
+
+    p_bank->pending_cw_flags |= rotary_encoder_take_flags(&p_flags->cw_flags);
+    p_bank->pending_ccw_flags |= rotary_encoder_take_flags(&p_flags->ccw_flags);
+    p_bank->pending_sw_flags |= rotary_encoder_take_flags(&p_flags->sw_flags);
+#if ROTARY_ENCODER_DELTA_INPUT
+    p_bank->pending_delta_flags |= rotary_encoder_take_flags(&p_flags->delta_flags);
+#endif
+
+#if ROTARY_ENCODER_EVENT_TIME
+    // Exactly the work taken and not yet handled
+    rotary_encoder_set_held(p_flags, p_bank->pending_cw_flags |
+                                     p_bank->pending_ccw_flags |
+#if ROTARY_ENCODER_DELTA_INPUT
+                                     p_bank->pending_delta_flags |
+#endif
+                                     p_bank->pending_sw_flags);
+#endif
+
+#if ROTARY_ENCODER_INERTIA
+    // Called once per task call for each bank
+    ++p_bank->tick;
+#endif
+
+#if ROTARY_ENCODER_LATENCY
+    // Often enough to never miss a timer wrap, as long as the task keeps up
+    rotary_encoder_clock(bank_num);
+#endif
+}
+
+#if ROTARY_ENCODER_EVENT_TIME
+/// Set the instances of a bank the task holds work of
+/// @param p_flags     Interrupt flags of the bank
+/// @param held_flags  Bit mask of the instances held
+static void rotary_encoder_set_held(rotary_encoder_bank_flags_t * const p_flags,
+                                    uint32_t const held_flags)
+{
+#if ROTARY_ENCODER_ATOMIC_FLAGS
+    atomic_store_explicit(&p_flags->held_flags, held_flags, memory_order_release);
+#else
+    p_flags->held_flags = held_flags;
+#endif
+}
+#endif
+
+/// Read what the interrupts set in one flags word, then clear it
+/// @param p_word Flags word to take
+/// @return The flags that were set
+static uint32_t rotary_encoder_take_flags(rotary_encoder_flag_word_t * const p_word)
+{
+#if ROTARY_ENCODER_ATOMIC_FLAGS
+    // Flags set between the read and the clear are never lost
+    return atomic_exchange_explicit(p_word, 0u, memory_order_acquire);
+#else
+    uint32_t const tmp_flags = *p_word;
+
+    *p_word = 0;
+
+    return tmp_flags;
+#endif
+}
+
+#if ROTARY_ENCODER_BANKS > 1u
+/// Move the bit of one instance from one interrupt flags word to another
+/// @param p_from       Flags word to take the bit from
+/// @param p_to         Flags word to set the bit in if it was set, not p_from
+/// @param instance_num Instance number, must be valid
+static void rotary_encoder_move_flag(rotary_encoder_flag_word_t * const p_from,
+                                     rotary_encoder_flag_word_t * const p_to,
+                                     uint8_t const instance_num)
+{
+    uint32_t const mask = (1u << instance_num);
+
+#if ROTARY_ENCODER_ATOMIC_FLAGS
+    uint32_t const tmp_flags = atomic_fetch_and_explicit(p_from, ~mask,
+                                                         memory_order_acquire);
+#else
+    uint32_t const tmp_flags = *p_from;
+
+    *p_from &= ~mask;
+#endif
+
+    if(0u != (tmp_flags & mask))
+    {
+        rotary_encoder_isr_flag(p_to, instance_num);
+    }
+}
+#endif
+
+#if ROTARY_ENCODER_LATENCY
+/// Extend ROTARY_ENCODER_TIMESTAMP() to 64 bits for a bank
+/// Must be called at least once per timer wrap, the task does that.
+/// @param bank_num Bank number to extend the time of
+/// @return The bank time now, in ROTARY_ENCODER_TIMESTAMP() ticks
+static uint64_t rotary_encoder_clock(uint8_t const bank_num)
+{
+    uint64_t const time = rotary_encoder_clock_now(bank_num);
+
+    bank_arr[bank_num].time = time;
+
+    return time;
+}
+
+/// Get the bank time now without moving the bank clock, from any thread
+/// Correct as long as the task moved the clock within the last timer wrap.
+/// @param bank_num Bank number to get the time of
+/// @return The bank time now, in ROTARY_ENCODER_TIMESTAMP() ticks
+static uint64_t rotary_encoder_clock_now(uint8_t const bank_num)
+{
+    uint64_t const time = bank_arr[bank_num].time;
+    uint32_t const now = (uint32_t)ROTARY_ENCODER_TIMESTAMP() & ROTARY_ENCODER_TIMESTAMP_MASK;
+
+    return time + ROTARY_ENCODER_TIMESTAMP_DIFF(now, (uint32_t)time);
+}
+
+/// Count the latency of an event the application just read
+/// Runs on the reader side, so it only reads the bank clock
+/// @param instance_num Instance number of the event
+static void rotary_encoder_latency_sample(uint8_t const instance_num)
+{
+    uint8_t const bank_num = rotary_encoder_instance_bank[instance_num];
+    rotary_encoder_bank_t * const p_bank = &bank_arr[bank_num];
+    uint64_t const elapsed = rotary_encoder_clock_now(bank_num) -
+                             instance_arr[instance_num].event_time;
+    uint32_t const latency = (UINT32_MAX < elapsed) ? UINT32_MAX : (uint32_t)elapsed;
+    uint8_t n = 0;
+
+    // Bucket n holds latencies of 2^n up to 2^(n+1) - 1 ticks, 0 goes in 0
+    for(uint32_t rest = latency >> 1; 0u != rest; rest >>= 1)
+    {
+        ++n;
+    }
+
+#if ROTARY_ENCODER_MULTI_READER
+    // Readers on other threads may count events of the same bank at once
+    unsigned latency_max = atomic_load_explicit(&p_bank->latency_max, memory_order_relaxed);
+
+    atomic_fetch_add_explicit(&p_bank->latency_hist[n], 1u, memory_order_relaxed);
+
+    // Retries only if another reader raised the max in between
+    while((latency > latency_max) &&
+          !atomic_compare_exchange_weak_explicit(&p_bank->latency_max, &latency_max, latency,
+                                                 memory_order_relaxed,
+                                                 memory_order_relaxed))
+    {
+    }
+#else
+    ++p_bank->latency_hist[n];
+
+    p_bank->latency_max = (latency > p_bank->latency_max) ? latency : p_bank->latency_max;
+#endif
+}
+#endif
+
+/// Collect the flags of one bank and handle all of its pending instances
+/// @param bank_num Bank number to handle
+static void rotary_encoder_run_bank(uint8_t const bank_num)
+{
+    rotary_encoder_bank_t * const p_bank = &bank_arr[bank_num];
+
+    rotary_encoder_collect_flags(bank_num);
+
+    // Loop through and make changes as needed
+    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+    {
+        if((0u != (p_bank->member_flags & (1u << i))) &&
+           rotary_encoder_pending(i))
+        {
+            rotary_encoder_process(i);
+        }
+    }
+
+    rotary_encoder_tick(bank_num);
+}
+
+/// Advance what moves on its own in a bank by one task call
+/// @param bank_num Bank number to advance
+static void rotary_encoder_tick(uint8_t const bank_num)
+{
+#if ROTARY_ENCODER_INERTIA
+    rotary_encoder_coast(bank_num);
+#endif
+
+#if ROTARY_ENCODER_SLEW
+    // After coasting, so the output heads for the latest knob value
+    rotary_encoder_ramp(bank_num);
+#endif
+
+    (void)bank_num;
+}
+
+/// Check if the instance has flags waiting to be handled
+/// @param instance Instance number to check
+/// @return True if any pending flag is set for the instance, false otherwise
+static bool rotary_encoder_pending(uint8_t const instance_num)
+{
+    rotary_encoder_bank_t const * const p_bank =
+            &bank_arr[rotary_encoder_instance_bank[instance_num]];
+    uint32_t const mask = (1u << instance_num);
+
+    uint32_t pending_flags = p_bank->pending_cw_flags |
+                             p_bank->pending_ccw_flags |
+                             p_bank->pending_sw_flags;
+
+#if ROTARY_ENCODER_DELTA_INPUT
+    pending_flags |= p_bank->pending_delta_flags;
+#endif
+
+    return (0u != (pending_flags & mask));
+}
+
+/// Handle and clear the pending flags of one instance
+/// @param instance Instance number to handle
+static void rotary_encoder_process(uint8_t const instance_num)
+{
+#if ROTARY_ENCODER_COST_BUDGET
+    uint32_t const start = (uint32_t)ROTARY_ENCODER_TIMESTAMP();
+#endif
+
+    rotary_encoder_bank_t * const p_bank =
+            &bank_arr[rotary_encoder_instance_bank[instance_num]];
+    uint32_t const mask = (1u << instance_num);
+
+    // Check if any flags set first
+    bool b_increment = (0u != (mask & p_bank->pending_cw_flags));
+    bool b_decrement = (0u != (mask & p_bank->pending_ccw_flags));
+    bool b_switch    = (0u != (mask & p_bank->pending_sw_flags));
+
+    p_bank->pending_cw_flags &= ~mask;
+    p_bank->pending_ccw_flags &= ~mask;
+    p_bank->pending_sw_flags &= ~mask;
+
+    bool b_event = b_increment || b_decrement || b_switch;
+
+#if ROTARY_ENCODER_DELTA_INPUT
+    bool const b_delta = (0u != (mask & p_bank->pending_delta_flags));
+    int32_t const delta = b_delta ? rotary_encoder_take_delta(instance_num) : 0;
+
+    p_bank->pending_delta_flags &= ~mask;
+    b_event |= b_delta;
+#endif
+
+    if(b_event && rotary_encoder_initialized(instance_num))
+    {
+        bool b_changed = b_switch;
+
+        // Readers see all changes from this pass at once, or none of them
+        rotary_encoder_write_begin(instance_num);
+
+#if ROTARY_ENCODER_INERTIA
+        // A turn against the coast or a press grabs the knob and stops it
+        if(instance_arr[instance_num].b_coasting)
+        {
+            bool const b_cw = instance_arr[instance_num].b_coast_cw;
+
+            if(b_switch || (b_cw ? b_decrement : b_increment))
+            {
+                rotary_encoder_stop_coast(instance_num);
+                b_increment = b_increment && b_cw;
+                b_decrement = b_decrement && !b_cw;
+            }
+        }
+#endif
+
+#if ROTARY_ENCODER_REVERSAL_FILTER
+        // Both ways in one pass, take the way it was turning first
+        if(b_increment && b_decrement && (0 > instance_arr[instance_num].last_dir))
+        {
+            b_changed |= rotary_encoder_turn(instance_num, false);
+            b_decrement = false;
+        }
+#endif
+
+        // Flags set, handle them
+        if(b_increment)
+        {
+            b_changed |= rotary_encoder_turn(instance_num, true);
+        }
+
+        if(b_decrement)
+        {
+            b_changed |= rotary_encoder_turn(instance_num, false);
+        }
+
+#if ROTARY_ENCODER_DELTA_INPUT
+        // Deltas that cancel out are no event
+        if(0 != delta)
+        {
+            rotary_encoder_move(instance_num, delta);
+            b_changed = true;
+        }
+#endif
+
+        if(b_switch)
+        {
+            instance_arr[instance_num].switch_value =
+                    !instance_arr[instance_num].switch_value;
+        }
+
+#if ROTARY_ENCODER_LATENCY
+        // The event starts with the first interrupt the application has not seen
+        if(b_changed && !instance_arr[instance_num].b_event_occured)
+        {
+            uint64_t const time = p_bank->time;
+
+            instance_arr[instance_num].event_time =
+                    time -
+                    ROTARY_ENCODER_TIMESTAMP_DIFF((uint32_t)time,
+                                                  rotary_encoder_isr_state[instance_num].event_time);
+        }
+#endif
+
+#if ROTARY_ENCODER_NOTIFY_THRESHOLD
+        // Moves under the threshold are kept, but not notified or published
+        bool const b_notify = rotary_encoder_notify(instance_num, b_switch);
+
+        b_changed = b_changed && b_notify;
+#else
+        bool const b_notify = true;
+#endif
+
+        instance_arr[instance_num].b_event_occured |= b_changed;
+
+        rotary_encoder_write_finish(instance_num, b_notify);
+    }
+
+#if ROTARY_ENCODER_EVENT_TIME
+    // Handled, the next interrupt starts a new event time
+    rotary_encoder_bank_flags_t * const p_flags =
+            rotary_encoder_isr_bank(instance_num);
+
+#if ROTARY_ENCODER_ATOMIC_FLAGS
+    atomic_fetch_and_explicit(&p_flags->held_flags, ~mask, memory_order_release);
+#else
+    p_flags->held_flags &= ~mask;
+#endif
+#endif
+
+#if ROTARY_ENCODER_COST_BUDGET
+    rotary_encoder_charge(instance_num, start);
+#endif
+}
+
+/// Handle one knob turn event, stepping the value unless filtered
+/// @param instance_num Instance number to turn
+/// @param b_cw     True for clockwise, false for counter clockwise
+/// @return True if the value was stepped, false if the event was filtered
+static bool rotary_encoder_turn(uint8_t const instance_num, bool const b_cw)
+{
+    rotary_encoder_t * const p_inst = &instance_arr[instance_num];
+    bool b_take = true;
+
+#if ROTARY_ENCODER_REVERSAL_FILTER
+    int8_t const dir = b_cw ? 1 : -1;
+    uint32_t const edge_time = rotary_encoder_isr_state[instance_num].last_edge_time;
+    uint32_t const gap = ROTARY_ENCODER_TIMESTAMP_DIFF(edge_time, p_inst->last_step_time);
+
+    if((0u != p_inst->reversal_events) &&
+       (0 != p_inst->last_dir) &&
+       (dir != p_inst->last_dir))
+    {
+        bool const b_fast = (p_inst->last_step_gap < p_inst->reversal_dwell);
+
+        ++p_inst->reversal_count;
+
+        b_take = !b_fast ||
+                 (gap >= p_inst->reversal_dwell) ||
+                 (p_inst->reversal_count >= p_inst->reversal_events);
+    }
+
+    if(b_take)
+    {
+        p_inst->last_dir = dir;
+        p_inst->reversal_count = 0;
+        p_inst->last_step_gap = gap;
+        p_inst->last_step_time = edge_time;
+    }
+#endif
+
+    if(b_take)
+    {
+        rotary_encoder_step(instance_num, (b_cw == p_inst->b_knob_cw_rot_positive));
+
+#if ROTARY_ENCODER_INERTIA
+        rotary_encoder_track_velocity(instance_num, b_cw);
+#endif
+    }
+
+    return b_take;
+}
+
+#if ROTARY_ENCODER_INERTIA
+/// Update the velocity of an instance after a turn
+/// @param instance_num Instance number that turned
+/// @param b_cw         True for clockwise, false for counter clockwise
+static void rotary_encoder_track_velocity(uint8_t const instance_num, bool const b_cw)
+{
+    rotary_encoder_t * const p_inst = &instance_arr[instance_num];
+    rotary_encoder_bank_t * const p_bank =
+            &bank_arr[rotary_encoder_instance_bank[instance_num]];
+
+    if(0u != p_inst->coast_min_velocity)
+    {
+        uint32_t const interval = p_bank->tick - p_inst->last_turn_tick;
+        uint16_t const velocity = (0u == interval) ? 256u :
+                                  (256u > interval) ? (uint16_t)(256u / interval) :
+                                  0u;
+
+        // Smooth over the last turns in the same direction
+        p_inst->velocity = (b_cw == p_inst->b_coast_cw) ?
+                           (uint16_t)((p_inst->velocity + velocity) / 2u) :
+                           velocity;
+
+        p_inst->b_coast_cw = b_cw;
+        p_inst->b_coasting = false;
+        p_inst->coast_acc = 0;
+        p_inst->last_turn_tick = p_bank->tick;
+        p_inst->turn_interval = interval;
+
+        p_bank->inertia_flags |= (1u << instance_num);
+    }
+}
+
+/// Advance every turning or coasting instance of a bank by one task call
+/// Instances not in the bank inertia flags cost nothing here.
+/// @param bank_num Bank number to advance
+static void rotary_encoder_coast(uint8_t const bank_num)
+{
+    rotary_encoder_bank_t * const p_bank = &bank_arr[bank_num];
+
+    for(uint8_t i = 0;
+        (i < ROTARY_ENCODER_INSTANCES) && (0u != (p_bank->inertia_flags >> i));
+        i++)
+    {
+        if(0u != (p_bank->inertia_flags & (1u << i)))
+        {
+            rotary_encoder_coast_instance(i);
+        }
+    }
+}
+
+/// Advance one turning or coasting instance by one task call
+/// @param instance_num Instance number to advance
+static void rotary_encoder_coast_instance(uint8_t const instance_num)
+{
+    rotary_encoder_t * const p_inst = &instance_arr[instance_num];
+    uint32_t const tick = bank_arr[rotary_encoder_instance_bank[instance_num]].tick;
+
+    // The hand let go once the next turn is overdue
+    if(!p_inst->b_coasting &&
+       ((tick - p_inst->last_turn_tick) > p_inst->turn_interval))
+    {
+        p_inst->b_coasting = (p_inst->velocity >= p_inst->coast_min_velocity);
+
+        if(!p_inst->b_coasting)
+        {
+            rotary_encoder_stop_coast(instance_num);
+        }
+    }
+
+    if(p_inst->b_coasting)
+    {
+        bool b_publish = true;
+
+        rotary_encoder_write_begin(instance_num);
+
+        // Never more than a step per call, velocity is at most 256
+        p_inst->coast_acc += p_inst->velocity;
+        p_inst->velocity = (uint16_t)((p_inst->velocity * p_inst->coast_decay) >> 8);
+
+        if(256u <= p_inst->coast_acc)
+        {
+            int16_t const value = p_inst->knob_value;
+
+            p_inst->coast_acc = (uint16_t)(p_inst->coast_acc - 256u);
+            rotary_encoder_step(instance_num,
+                                (p_inst->b_coast_cw == p_inst->b_knob_cw_rot_positive));
+#if ROTARY_ENCODER_NOTIFY_THRESHOLD
+            b_publish = rotary_encoder_notify(instance_num, false);
+#endif
+
+#if ROTARY_ENCODER_LATENCY
+            // No interrupt behind a coast step, it happens now
+            if(b_publish && !p_inst->b_event_occured)
+            {
+                p_inst->event_time = bank_arr[rotary_encoder_instance_bank[instance_num]].time;
+            }
+#endif
+
+            p_inst->b_event_occured |= b_publish;
+
+            // Stepped on a bound, nothing left to coast
+            if(value == p_inst->knob_value)
+            {
+                rotary_encoder_stop_coast(instance_num);
+            }
+        }
+
+        if(ROTARY_ENCODER_COAST_STOP > p_inst->velocity)
+        {
+            rotary_encoder_stop_coast(instance_num);
+        }
+
+        rotary_encoder_write_finish(instance_num, b_publish);
+    }
+}
+
+/// Stop an instance coasting and forget its velocity
+/// @param instance_num Instance number to stop
+static void rotary_encoder_stop_coast(uint8_t const instance_num)
+{
+    instance_arr[instance_num].b_coasting = false;
+    instance_arr[instance_num].velocity = 0;
+    instance_arr[instance_num].coast_acc = 0;
+
+    bank_arr[rotary_encoder_instance_bank[instance_num]].inertia_flags &=
+            ~(1u << instance_num);
+}
+#endif
+
+#if ROTARY_ENCODER_SLEW
+/// Move the output value of every ramping instance of a bank toward its knob
+/// value.  Instances not in the bank ramp flags cost nothing here.
+/// @param bank_num Bank number to ramp
+static void rotary_encoder_ramp(uint8_t const bank_num)
+{
+    rotary_encoder_bank_t * const p_bank = &bank_arr[bank_num];
+
+    for(uint8_t i = 0;
+        (i < ROTARY_ENCODER_INSTANCES) && (0u != (p_bank->ramp_flags >> i));
+        i++)
+    {
+        if(0u != (p_bank->ramp_flags & (1u << i)))
+        {
+            rotary_encoder_t * const p_inst = &instance_arr[i];
+            int32_t const diff = (int32_t)p_inst->knob_value - p_inst->output_value;
+            int32_t const rate = p_inst->slew_rate;
+
+            rotary_encoder_write_begin(i);
+
+            if((diff <= rate) && (diff >= -rate))
+            {
+                p_inst->output_value = p_inst->knob_value;
+                p_bank->ramp_flags &= ~(1u << i);
+            }
+            else
+            {
+                // In int32, rate can be above INT16_MAX; the sum lands between
+                // the output and the knob value, so it fits an int16_t
+                p_inst->output_value = (int16_t)((int32_t)p_inst->output_value +
+                                                 ((0 < diff) ? rate : -rate));
+            }
+
+            rotary_encoder_write_end(i);
+        }
+    }
+}
+#endif
+
+/// Move the knob value one step and apply the bounds
+/// @param instance Instance number to step
+/// @param b_up     True to increment, false to decrement
+static void rotary_encoder_step(uint8_t const instance_num, bool const b_up)
+{
+#if ROTARY_ENCODER_SELF_CHECK
+    int32_t const ref_value = rotary_encoder_ref_move(&instance_arr[instance_num],
+                                                      b_up ? 1 : -1);
+#endif
+
+    rotary_encoder_force_bounds(instance_num,
+                                (int32_t)instance_arr[instance_num].knob_value +
+                                (b_up ? 1 : -1));
+
+#if ROTARY_ENCODER_SELF_CHECK
+    rotary_encoder_self_check(instance_num, ref_value);
+#endif
+}
+
+#if ROTARY_ENCODER_DELTA_INPUT
+/// Read the delta fed to an instance since the last take, then clear it
+/// @param instance_num Instance number to take the delta of
+/// @return The sum of the deltas fed
+static int32_t rotary_encoder_take_delta(uint8_t const instance_num)
+{
+#if ROTARY_ENCODER_ATOMIC_FLAGS
+    return atomic_exchange_explicit(&delta_acc_arr[instance_num].sum, 0,
+                                    memory_order_acquire);
+#else
+    int32_t const delta = delta_acc_arr[instance_num].sum;
+
+    delta_acc_arr[instance_num].sum = 0;
+
+    return delta;
+#endif
+}
+
+/// Add a delta to an accumulated total, saturating at the delta limit
+/// @param acc   Total so far, within the delta limit
+/// @param delta Delta to add
+/// @return The new total, within the delta limit
+static int32_t rotary_encoder_delta_sum(int32_t const acc, int16_t const delta)
+{
+    int32_t const sum = acc + delta;
+
+    return (sum > ROTARY_ENCODER_DELTA_LIMIT) ? ROTARY_ENCODER_DELTA_LIMIT :
+           (sum < -ROTARY_ENCODER_DELTA_LIMIT) ? -ROTARY_ENCODER_DELTA_LIMIT : sum;
+}
+
+/// Move the knob value by any number of steps and apply the bounds
+/// Same result as stepping delta times, in constant time.
+/// @param instance_num Instance number to move
+/// @param delta        Steps to move, positive to increment, within the delta
+///                     limit so the sums below never overflow
+static void rotary_encoder_move(uint8_t const instance_num, int32_t const delta)
+{
+    rotary_encoder_t * const p_inst = &instance_arr[instance_num];
+    int32_t const min_value = p_inst->knob_min_value;
+    int32_t const max_value = p_inst->knob_max_value;
+    int32_t value = (int32_t)p_inst->knob_value + delta;
+
+#if ROTARY_ENCODER_SELF_CHECK
+    int32_t const ref_value = rotary_encoder_ref_move(p_inst, delta);
+#endif
+
+    bool const b_out = (value > max_value) || (value < min_value);
+
+    if(b_out && p_inst->b_knob_allow_step_on)
+    {
+        value = (value > max_value) ? max_value : min_value;
+    }
+    else if(b_out && (0 < p_inst->knob_range))
+    {
+        // Rolls over as many times as it passed a bound
+        int32_t const offset = value - min_value;
+
+        value = min_value + rotary_encoder_wrap(p_inst, offset);
+    }
+
+    p_inst->knob_value = (int16_t)value;
+
+    if(b_out)
+    {
+        rotary_encoder_alert(instance_num, (0 < delta), p_inst->b_knob_allow_step_on);
+    }
+
+#if ROTARY_ENCODER_SELF_CHECK
+    rotary_encoder_self_check(instance_num, ref_value);
+#endif
+}
+
+/// Offset modulo the knob range, without a divide for MCUs that have none
+/// @param p_inst Instance with a knob range above 0
+/// @param offset Value minus the min value, any sign
+/// @return Offset folded into 0 to knob range - 1
+static int32_t rotary_encoder_wrap(rotary_encoder_t const * const p_inst,
+                                   int32_t const offset)
+{
+    uint32_t const range = (uint32_t)p_inst->knob_range;
+
+    // Below min counts down from the top, -1 maps to range - 1
+    uint32_t const n = (0 > offset) ? ~(uint32_t)offset : (uint32_t)offset;
+    uint32_t rem;
+
+    if(0u == (range & (range - 1u)))
+    {
+        rem = n & (range - 1u);
+    }
+    else
+    {
+        // The reciprocal rounds down, so the quotient is short by at most 1
+        uint32_t const quot = (uint32_t)(((uint64_t)n * p_inst->knob_range_recip) >> 32);
+
+        rem = n - (quot * range);
+        rem = (rem >= range) ? (rem - range) : rem;
+    }
+
+    return (int32_t)((0 > offset) ? (range - 1u - rem) : rem);
+}
+#endif
+
+#if ROTARY_ENCODER_SELF_CHECK
+/// Reference model of a knob move, one plain step at a time with the bounds
+/// checked after each, as the module first did it.  Slow on purpose, every
+/// faster path must land on the same value.  After the first step the value
+/// is in bounds, and from there every knob range more steps either ends on
+/// the same bound or comes back round to the same value, so those laps are
+/// skipped and a move costs at most the knob range in steps.
+/// @param p_inst Instance before the move
+/// @param delta  Steps to move, negative to go down
+/// @return Knob value after the move
+static int32_t rotary_encoder_ref_move(rotary_encoder_t const * const p_inst,
+                                       int32_t const delta)
+{
+    int32_t const min_value = p_inst->knob_min_value;
+    int32_t const max_value = p_inst->knob_max_value;
+    bool const b_step_on = p_inst->b_knob_allow_step_on;
+    int32_t const dir = (0 > delta) ? -1 : 1;
+    int32_t value = p_inst->knob_value;
+    uint32_t steps = (0 > delta) ? (0u - (uint32_t)delta) : (uint32_t)delta;
+
+    if(min_value <= max_value)
+    {
+        uint32_t const range = (uint32_t)(max_value - min_value) + 1u;
+
+        if(steps > range)
+        {
+            steps = b_step_on ? (range + 1u) : (1u + ((steps - 1u) % range));
+        }
+    }
+
+    for(uint32_t n = 0; n < steps; n++)
+    {
+        value += dir;
+
+        if(value > max_value)
+        {
+            value = b_step_on ? max_value : min_value;
+        }
+        else if(value < min_value)
+        {
+            value = b_step_on ? min_value : max_value;
+        }
+    }
+
+    return value;
+}
+
+/// Check a knob move against the reference model
+/// Bounds with min above max have no defined result, so they are not checked
+/// @param instance_num Instance number that moved
+/// @param ref_value    Value rotary_encoder_ref_move() gave for the move
+static void rotary_encoder_self_check(uint8_t const instance_num,
+                                      int32_t const ref_value)
+{
+    rotary_encoder_t const * const p_inst = &instance_arr[instance_num];
+
+    if(p_inst->knob_min_value <= p_inst->knob_max_value)
+    {
+        ROTARY_ENCODER_ASSERT(ref_value == p_inst->knob_value);
+        ROTARY_ENCODER_ASSERT(p_inst->knob_min_value <= p_inst->knob_value);
+        ROTARY_ENCODER_ASSERT(p_inst->knob_max_value >= p_inst->knob_value);
+    }
+}
+#endif
+
+#if ROTARY_ENCODER_COST_BUDGET
+/// Charge the time spent handling an instance event against the budget
+/// @param instance_num Instance number handled
+/// @param start        ROTARY_ENCODER_TIMESTAMP() when handling started
+static void rotary_encoder_charge(uint8_t const instance_num, uint32_t const start)
+{
+    rotary_encoder_bank_t * const p_bank =
+            &bank_arr[rotary_encoder_instance_bank[instance_num]];
+    uint32_t const cost =
+            ROTARY_ENCODER_TIMESTAMP_DIFF((uint32_t)ROTARY_ENCODER_TIMESTAMP(), start);
+
+    p_bank->cost_max = (cost > p_bank->cost_max) ? cost : p_bank->cost_max;
+
+    if((0u != cost_budget) && (cost > cost_budget) && (0 != cost_hook))
+    {
+        cost_hook(instance_num, cost);
+    }
+}
+#endif
+
+/// Put an instance back to its state right after init
+/// @param instance_num Instance number, must be within array bounds
+/// @param min_value    Min value the knob can report
+/// @param max_value    Max value the knob can report
+/// @param step_on      True if step on value if meets max/min
+/// @param cw_rot_pos   True if clockwise rotation is positive, false if negative
+static void rotary_encoder_reset(uint8_t const instance_num,
+                                 int16_t const min_value,
+                                 int16_t const max_value,
+                                 bool    const step_on,
+                                 bool    const cw_rot_pos)
+{
+    rotary_encoder_write_begin(instance_num);
+
+    instance_arr[instance_num].b_initialized = true;
+
+    // Start at 0, or the bound closest to it when 0 is out of bounds
+    instance_arr[instance_num].knob_value = (0 < min_value) ? min_value :
+                                            (0 > max_value) ? max_value : 0;
+    rotary_encoder_set_bounds(instance_num, min_value, max_value, step_on);
+    instance_arr[instance_num].b_knob_cw_rot_positive = cw_rot_pos;
+
+    instance_arr[instance_num].switch_value = 0;
+
+    instance_arr[instance_num].b_event_occured = false;
+    instance_arr[instance_num].b_alert_occured = false;
+
+#if ROTARY_ENCODER_NOTIFY_THRESHOLD
+    instance_arr[instance_num].notified_value = instance_arr[instance_num].knob_value;
+    instance_arr[instance_num].notify_threshold = 0;
+#endif
+
+#if ROTARY_ENCODER_ALERT_BITS
+    instance_arr[instance_num].alert_bits = 0;
+    instance_arr[instance_num].alert_count = 0;
+#endif
+
+#if ROTARY_ENCODER_GLITCH_FILTER
+    rotary_encoder_isr_state[instance_num].min_edge_interval = 0;
+    rotary_encoder_isr_state[instance_num].glitch_count = 0;
+#endif
+
+#if ROTARY_ENCODER_STORM_GUARD
+    rotary_encoder_isr_state[instance_num].storm_window = 0;
+    rotary_encoder_isr_state[instance_num].storm_count = 0;
+#endif
+
+#if ROTARY_ENCODER_REVERSAL_FILTER
+    instance_arr[instance_num].last_dir = 0;
+    instance_arr[instance_num].reversal_count = 0;
+    instance_arr[instance_num].reversal_events = 0;
+#endif
+
+#if ROTARY_ENCODER_INERTIA
+    instance_arr[instance_num].coast_min_velocity = 0;
+    rotary_encoder_stop_coast(instance_num);
+#endif
+
+#if ROTARY_ENCODER_PARAMS
+    instance_arr[instance_num].p_param = 0;
+#endif
+
+#if ROTARY_ENCODER_SLEW
+    instance_arr[instance_num].output_value = instance_arr[instance_num].knob_value;
+    instance_arr[instance_num].slew_rate = 0;
+#endif
+
+    rotary_encoder_write_end(instance_num);
+}
+
+/// Set the knob bounds and the range derived from them
+/// @param instance_num Instance number, must be within array bounds
+/// @param min_value    Min value the knob can report
+/// @param max_value    Max value the knob can report
+/// @param step_on      True if step on value if meets max/min
+static void rotary_encoder_set_bounds(uint8_t const instance_num,
+                                      int16_t const min_value,
+                                      int16_t const max_value,
+                                      bool    const step_on)
+{
+    rotary_encoder_t * const p_inst = &instance_arr[instance_num];
+
+    p_inst->knob_min_value = min_value;
+    p_inst->knob_max_value = max_value;
+    p_inst->b_knob_allow_step_on = step_on;
+
+#if ROTARY_ENCODER_DELTA_INPUT
+    // Worked out once here so wrapping a delta never divides
+    p_inst->knob_range = (int32_t)max_value - min_value + 1;
+    p_inst->knob_range_recip = (0 < p_inst->knob_range) ?
+                               (0xFFFFFFFFu / (uint32_t)p_inst->knob_range) : 0u;
+#endif
+}
+
+/// Start changing an instance, readers retry until the matching end
+/// Only one thread may write an instance at a time
+/// @param instance Instance number about to be changed
+static void rotary_encoder_write_begin(uint8_t const instance_num)
+{
+#if ROTARY_ENCODER_MULTI_READER
+    atomic_uint * const p_seq = &instance_arr[instance_num].seq;
+    unsigned const seq = atomic_load_explicit(p_seq, memory_order_relaxed);
+
+    atomic_store_explicit(p_seq, seq + 1u, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+#else
+    (void)instance_num;
+#endif
+}
+
+/// Finish changing an instance, publishing the changes to readers
+/// @param instance Instance number that was changed
+static void rotary_encoder_write_end(uint8_t const instance_num)
+{
+    rotary_encoder_write_finish(instance_num, true);
+}
+
+/// Finish changing an instance, optionally leaving it out of the next publish
+/// Readers of the instance itself always see the changes.
+/// @param instance  Instance number that was changed
+/// @param b_publish True to pass the change to frames and pass hooks
+static void rotary_encoder_write_finish(uint8_t const instance_num,
+                                        bool const b_publish)
+{
+#if ROTARY_ENCODER_PARAMS
+    rotary_encoder_param_sync(instance_num);
+#endif
+
+#if ROTARY_ENCODER_SLEW
+    rotary_encoder_t * const p_inst = &instance_arr[instance_num];
+
+    // Any change to the knob value starts a ramp toward it
+    if(p_inst->output_value != p_inst->knob_value)
+    {
+        if(0u == p_inst->slew_rate)
+        {
+            p_inst->output_value = p_inst->knob_value;
+        }
+        else
+        {
+            bank_arr[rotary_encoder_instance_bank[instance_num]].ramp_flags |=
+                    (1u << instance_num);
+        }
+    }
+#endif
+
+#if ROTARY_ENCODER_MULTI_READER
+    atomic_uint * const p_seq = &instance_arr[instance_num].seq;
+    unsigned const seq = atomic_load_explicit(p_seq, memory_order_relaxed);
+
+    rotary_encoder_share(&instance_arr[instance_num]);
+
+    atomic_store_explicit(p_seq, seq + 1u, memory_order_release);
+#else
+    (void)instance_num;
+#endif
+
+#if ROTARY_ENCODER_BANKS > 1u
+    // Bank tasks on other cores publish through the same word
+    if(b_publish)
+    {
+        atomic_fetch_or_explicit(&bank_arr[rotary_encoder_instance_bank[instance_num]].changed_flags,
+                                 (1u << instance_num), memory_order_relaxed);
+    }
+#elif ROTARY_ENCODER_FRAMES || ROTARY_ENCODER_PASS_HOOKS
+    if(b_publish)
+    {
+        bank_arr[0].changed_flags |= (1u << instance_num);
+    }
+#else
+    (void)b_publish;
+#endif
+}
+
+#if ROTARY_ENCODER_NOTIFY_THRESHOLD
+/// Check if a change is big enough to notify, and if so measure from it on
+/// @param instance_num Instance number that changed
+/// @param b_switch     True if the switch changed, always notified
+/// @return True to notify, false to keep quiet
+static bool rotary_encoder_notify(uint8_t const instance_num, bool const b_switch)
+{
+    rotary_encoder_t * const p_inst = &instance_arr[instance_num];
+    int32_t const moved = (int32_t)p_inst->knob_value - p_inst->notified_value;
+    int32_t const threshold = p_inst->notify_threshold;
+
+    bool const b_notify = b_switch || (moved >= threshold) || (moved <= -threshold);
+
+    if(b_notify)
+    {
+        p_inst->notified_value = p_inst->knob_value;
+    }
+
+    return b_notify;
+}
+#endif
+
+#if ROTARY_ENCODER_PARAMS
+/// Write the knob value to the bound parameter once it is picked up
+/// @param instance_num Instance number that changed
+static void rotary_encoder_param_sync(uint8_t const instance_num)
+{
+    rotary_encoder_t * const p_inst = &instance_arr[instance_num];
+    rotary_encoder_param_t * const p_param = p_inst->p_param;
+
+    if(0 != p_param)
+    {
+        int8_t const side = (p_inst->knob_value > p_param->value) ? 1 :
+                            (p_inst->knob_value < p_param->value) ? -1 : 0;
+
+        // Reached or crossed the parameter value
+        p_inst->b_param_picked_up |= (side != p_inst->param_side);
+
+        if(p_inst->b_param_picked_up)
+        {
+            p_param->value = p_inst->knob_value;
+        }
+    }
+}
+#endif
+
+/// Copy the instance state, retrying if a write happened during the copy
+/// @param instance   Instance number to read
+/// @param p_snapshot Where to copy the instance state
+static void rotary_encoder_read(uint8_t const instance_num,
+                                rotary_encoder_snapshot_t * const p_snapshot)
+{
+    rotary_encoder_t const * const p_inst = &instance_arr[instance_num];
+
+#if ROTARY_ENCODER_MULTI_READER
+    unsigned seq_start;
+    unsigned seq_end;
+
+    do
+    {
+        seq_start = atomic_load_explicit(&p_inst->seq, memory_order_acquire);
+
+        // Only the shared copy, the task writes the plain fields at any time
+        rotary_encoder_unpack(atomic_load_explicit(&p_inst->shared_state,
+                                                   memory_order_relaxed),
+                              p_snapshot);
+
+#if ROTARY_ENCODER_SLEW
+        p_snapshot->output_value =
+                (int16_t)(uint16_t)atomic_load_explicit(&p_inst->shared_output,
+                                                        memory_order_relaxed);
+#endif
+
+        atomic_thread_fence(memory_order_acquire);
+        seq_end = atomic_load_explicit(&p_inst->seq, memory_order_relaxed);
+
+    // Odd means a write was in progress, a change means one happened
+    } while((0u != (seq_start & 1u)) || (seq_start != seq_end));
+#else
+    rotary_encoder_copy(p_inst, p_snapshot);
+#endif
+}
+
+#if ROTARY_ENCODER_MULTI_READER || ROTARY_ENCODER_FRAMES
+/// Unpack the state word readers see into a snapshot, all but the output value
+/// @param state      Packed state, see ROTARY_ENCODER_SHARED_SW
+/// @param p_snapshot Where to unpack the state
+static void rotary_encoder_unpack(unsigned const state,
+                                  rotary_encoder_snapshot_t * const p_snapshot)
+{
+    p_snapshot->knob_value = (int16_t)(uint16_t)state;
+    p_snapshot->b_switch_value = (0u != (state & ROTARY_ENCODER_SHARED_SW));
+    p_snapshot->b_event_occured = (0u != (state & ROTARY_ENCODER_SHARED_EVENT));
+    p_snapshot->b_alert_occured = (0u != (state & ROTARY_ENCODER_SHARED_ALERT));
+}
+#endif
+
+#if ROTARY_ENCODER_FRAMES
+/// Pack a snapshot into one state word, all but the output value
+/// @param p_snapshot Snapshot to pack
+/// @return Packed state, see ROTARY_ENCODER_SHARED_SW
+static unsigned rotary_encoder_pack(rotary_encoder_snapshot_t const * const p_snapshot)
+{
+    return (unsigned)(uint16_t)p_snapshot->knob_value |
+           (p_snapshot->b_switch_value ? ROTARY_ENCODER_SHARED_SW : 0u) |
+           (p_snapshot->b_event_occured ? ROTARY_ENCODER_SHARED_EVENT : 0u) |
+           (p_snapshot->b_alert_occured ? ROTARY_ENCODER_SHARED_ALERT : 0u);
+}
+#endif
+
+#if !ROTARY_ENCODER_MULTI_READER
+/// Copy the instance state fields that are visible outside the module
+/// @param p_inst     Instance to copy from
+/// @param p_snapshot Where to copy the instance state
+static void rotary_encoder_copy(rotary_encoder_t const * const p_inst,
+                                rotary_encoder_snapshot_t * const p_snapshot)
+{
+    p_snapshot->knob_value = p_inst->knob_value;
+    p_snapshot->b_switch_value = (0 != p_inst->switch_value);
+    p_snapshot->b_event_occured = p_inst->b_event_occured;
+    p_snapshot->b_alert_occured = p_inst->b_alert_occured;
+
+#if ROTARY_ENCODER_SLEW
+    p_snapshot->output_value = p_inst->output_value;
+#endif
+}
+#endif
+
+#if ROTARY_ENCODER_MULTI_READER
+/// Update the copy readers see, under the sequence lock
+/// Readers never touch the plain fields, which the task writes without atomics
+/// @param p_inst Instance being written
+static void rotary_encoder_share(rotary_encoder_t * const p_inst)
+{
+    unsigned const state = (unsigned)(uint16_t)p_inst->knob_value |
+                           ((0 != p_inst->switch_value) ? ROTARY_ENCODER_SHARED_SW : 0u) |
+                           (p_inst->b_event_occured ? ROTARY_ENCODER_SHARED_EVENT : 0u) |
+                           (p_inst->b_alert_occured ? ROTARY_ENCODER_SHARED_ALERT : 0u);
+
+    atomic_store_explicit(&p_inst->shared_state, state, memory_order_relaxed);
+
+#if ROTARY_ENCODER_SLEW
+    atomic_store_explicit(&p_inst->shared_output,
+                          (unsigned)(uint16_t)p_inst->output_value,
+                          memory_order_relaxed);
+#endif
+}
+#endif
+
+/// Publish what changed since the last call to frames and pass hooks
+/// The task functions call this, except rotary_encoder_task_bank() with more
+/// than one bank.  Call from one thread only.
+/// Does nothing if no instance changed since the last publish
+void rotary_encoder_publish(void)
+{
+#if ROTARY_ENCODER_BANKS > 1u
+    uint32_t tmp_changed_flags = 0;
+
+    for(uint8_t b = 0; b < ROTARY_ENCODER_BANKS; b++)
+    {
+        tmp_changed_flags |= atomic_exchange_explicit(&bank_arr[b].changed_flags,
+                                                      0u, memory_order_relaxed);
+    }
+#elif ROTARY_ENCODER_FRAMES || ROTARY_ENCODER_PASS_HOOKS
+    uint32_t const tmp_changed_flags = bank_arr[0].changed_flags;
+
+    bank_arr[0].changed_flags = 0;
+#endif
+
+#if ROTARY_ENCODER_FRAMES
+    // Build the back frame from every instance and swap it in as the front
+    if(0u != tmp_changed_flags)
+    {
+        rotary_encoder_frame_t const * const p_front =
+                atomic_load_explicit(&p_front_frame, memory_order_relaxed);
+        rotary_encoder_frame_t * const p_back = &frame_arr[frame_back];
+        atomic_uint * const p_seq = &frame_seq_arr[frame_back];
+        atomic_uint * const p_word = &frame_word_arr[frame_back][0];
+        unsigned const seq = atomic_load_explicit(p_seq, memory_order_relaxed);
+
+        // Readers still copying this frame from a lap ago see it change
+        atomic_store_explicit(p_seq, seq + 1u, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        p_back->frame_num = p_front->frame_num + 1u;
+        atomic_store_explicit(&p_word[0], p_back->frame_num, memory_order_relaxed);
+
+        for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+        {
+#if ROTARY_ENCODER_MULTI_READER
+            // Other bank tasks may be writing, read the shared copy
+            rotary_encoder_read(i, &p_back->instance[i]);
+#else
+            // Only this thread writes instances, no sequence lock needed
+            rotary_encoder_copy(&instance_arr[i], &p_back->instance[i]);
+#endif
+
+            atomic_store_explicit(&p_word[1u + i], rotary_encoder_pack(&p_back->instance[i]),
+                                  memory_order_relaxed);
+
+#if ROTARY_ENCODER_SLEW
+            atomic_store_explicit(&p_word[1u + ROTARY_ENCODER_INSTANCES + i],
+                                  (unsigned)(uint16_t)p_back->instance[i].output_value,
+                                  memory_order_relaxed);
+#endif
+        }
+
+        atomic_store_explicit(p_seq, seq + 2u, memory_order_release);
+        atomic_store_explicit(&p_front_frame, p_back, memory_order_release);
+
+        frame_back = ((frame_back + 1u) < ROTARY_ENCODER_FRAMES) ?
+                     (frame_back + 1u) : 0u;
+    }
+#endif
+
+#if ROTARY_ENCODER_PASS_HOOKS
+    if(0u != tmp_changed_flags)
+    {
+        for(uint8_t i = 0; i < ROTARY_ENCODER_PASS_HOOKS; i++)
+        {
+            if(0 != pass_hook_arr[i])
+            {
+                pass_hook_arr[i](tmp_changed_flags);
+            }
+        }
+    }
+#endif
+}
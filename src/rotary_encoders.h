@@ -15,25 +15,224 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-/// Max number of instances this program supports
-/// Increase or decrease for your needs
-/// Can be up to 32 before having to change code
-#define ROTARY_ENCODER_INSTANCES 4u
+#include "rotary_encoders_config.h"
 
 /// Flags that are set in g_rotary_encoder_flags
 #define ROTARY_ENCODER_FLAG_CW    0x01u
 #define ROTARY_ENCODER_FLAG_CCW   0x02u
 #define ROTARY_ENCODER_FLAG_SW    0x04u
 
+/// Alert bits reported by rotary_encoder_take_alerts()
+#define ROTARY_ENCODER_ALERT_CLAMP_MAX 0x01u
+#define ROTARY_ENCODER_ALERT_CLAMP_MIN 0x02u
+#define ROTARY_ENCODER_ALERT_WRAP_MAX  0x04u
+#define ROTARY_ENCODER_ALERT_WRAP_MIN  0x08u
+
+#if ROTARY_ENCODER_ATOMIC_FLAGS
+#include <stdatomic.h>
+
+/// Interrupt flags word, each bit is the instance flagged
+typedef _Atomic uint32_t rotary_encoder_flag_word_t;
+#else
+/// Interrupt flags word, each bit is the instance flagged
+typedef volatile uint32_t rotary_encoder_flag_word_t;
+#endif
+
+#if (ROTARY_ENCODER_BANKS > 1u) || ROTARY_ENCODER_PADDED_LAYOUT
+/// Keep each bank on its own cache lines so cores never share one
+#define ROTARY_ENCODER_BANK_ALIGN _Alignas(ROTARY_ENCODER_CACHE_LINE)
+#else
+#define ROTARY_ENCODER_BANK_ALIGN
+#endif
+
+#if ROTARY_ENCODER_PADDED_LAYOUT
+/// Start a new cache line, keeping instances apart from each other
+#define ROTARY_ENCODER_LINE_ALIGN _Alignas(ROTARY_ENCODER_CACHE_LINE)
+#else
+#define ROTARY_ENCODER_LINE_ALIGN
+#endif
+
+/// Set when the interrupt functions stamp the time work becomes pending
+#define ROTARY_ENCODER_EVENT_TIME (ROTARY_ENCODER_LATENCY || \
+                                   ROTARY_ENCODER_WATCHDOG)
+
+/// Flags set by interrupts for the instances of one bank
+/// Only written through rotary_encoder_set_flags() and the rotary_encoder_isr
+/// functions, cleared by the task.
+typedef struct rotary_encoder_bank_flags
+{
+    ROTARY_ENCODER_BANK_ALIGN rotary_encoder_flag_word_t cw_flags;
+    rotary_encoder_flag_word_t ccw_flags;
+    rotary_encoder_flag_word_t sw_flags;
+
+#if ROTARY_ENCODER_DELTA_INPUT
+    rotary_encoder_flag_word_t delta_flags;
+#endif
+
+#if ROTARY_ENCODER_EVENT_TIME
+    /// Instances the task took flags of but has not handled yet, written by
+    /// the task only.  Keeps their event time until they are handled.
+    rotary_encoder_flag_word_t held_flags;
+#endif
+
+} rotary_encoder_bank_flags_t;
+
+#if ROTARY_ENCODER_GLITCH_FILTER && !defined(ROTARY_ENCODER_TIMESTAMP)
+#error "ROTARY_ENCODER_GLITCH_FILTER needs ROTARY_ENCODER_TIMESTAMP()"
+#endif
+
+#if ROTARY_ENCODER_REVERSAL_FILTER && !defined(ROTARY_ENCODER_TIMESTAMP)
+#error "ROTARY_ENCODER_REVERSAL_FILTER needs ROTARY_ENCODER_TIMESTAMP()"
+#endif
+
+#if ROTARY_ENCODER_LATENCY && !defined(ROTARY_ENCODER_TIMESTAMP)
+#error "ROTARY_ENCODER_LATENCY needs ROTARY_ENCODER_TIMESTAMP()"
+#endif
+
+#if ROTARY_ENCODER_WATCHDOG && !defined(ROTARY_ENCODER_TIMESTAMP)
+#error "ROTARY_ENCODER_WATCHDOG needs ROTARY_ENCODER_TIMESTAMP()"
+#endif
+
+#if ROTARY_ENCODER_STORM_GUARD && !defined(ROTARY_ENCODER_TIMESTAMP)
+#error "ROTARY_ENCODER_STORM_GUARD needs ROTARY_ENCODER_TIMESTAMP()"
+#endif
+
+#if ROTARY_ENCODER_COST_BUDGET && !defined(ROTARY_ENCODER_TIMESTAMP)
+#error "ROTARY_ENCODER_COST_BUDGET needs ROTARY_ENCODER_TIMESTAMP()"
+#endif
+
+/// Mask of the bits ROTARY_ENCODER_TIMESTAMP() counts
+#define ROTARY_ENCODER_TIMESTAMP_MASK \
+        ((uint32_t)(((uint64_t)1u << ROTARY_ENCODER_TIMESTAMP_BITS) - 1u))
+
+/// Ticks from timestamp start to timestamp end, correct across one wrap
+#define ROTARY_ENCODER_TIMESTAMP_DIFF(end, start) \
+        ((uint32_t)((end) - (start)) & ROTARY_ENCODER_TIMESTAMP_MASK)
+
+/// Set when instances need state kept by the interrupt functions
+#define ROTARY_ENCODER_ISR_STATE (ROTARY_ENCODER_GLITCH_FILTER || \
+                                  ROTARY_ENCODER_STORM_GUARD || \
+                                  ROTARY_ENCODER_REVERSAL_FILTER || \
+                                  ROTARY_ENCODER_EVENT_TIME)
+
+#if ROTARY_ENCODER_ISR_STATE
+/// Per instance state only the interrupt functions write
+/// With ROTARY_ENCODER_PADDED_LAYOUT each instance starts its own cache line,
+/// so interrupts of instances on different cores never share one
+typedef struct rotary_encoder_isr_state
+{
+    ROTARY_ENCODER_LINE_ALIGN struct
+    {
+#if ROTARY_ENCODER_GLITCH_FILTER || ROTARY_ENCODER_REVERSAL_FILTER
+        uint32_t last_edge_time;     /// Timestamp of the last accepted knob edge
+#endif
+
+#if ROTARY_ENCODER_GLITCH_FILTER
+        uint32_t min_edge_interval;  /// Knob edges sooner than this are dropped
+        uint32_t glitch_count;       /// Number of knob edges dropped
+#endif
+
+#if ROTARY_ENCODER_STORM_GUARD
+        uint32_t storm_window;       /// Ticks edges are counted over, 0 disables
+        uint32_t storm_window_start; /// Timestamp the current window started
+        uint16_t storm_max_edges;    /// More edges than this in a window trips
+        uint16_t storm_edges;        /// Knob edges in the current window
+        uint16_t storm_count;        /// Number of times the guard tripped
+        bool b_storm_polled;         /// Interrupt masked, polled from a timer
+#endif
+
+#if ROTARY_ENCODER_EVENT_TIME
+        uint32_t event_time;         /// Timestamp of the first flag not yet taken
+#endif
+    };
+
+} rotary_encoder_isr_state_t;
+#endif
+
+#if ROTARY_ENCODER_STORM_GUARD
+/// Functions the storm guard uses to reach the encoder hardware
+typedef struct rotary_encoder_storm_hooks
+{
+    /// Enable or disable the knob interrupt of an instance
+    void (*set_irq_enabled)(uint8_t const instance_num, bool const b_enable);
+
+    /// Sample the knob pins of an instance, called from
+    /// rotary_encoder_storm_poll() while the interrupt is masked
+    /// @return ROTARY_ENCODER_FLAG_CW or ROTARY_ENCODER_FLAG_CCW for a turn
+    ///         since the last sample, 0 for none
+    uint8_t (*poll_knob)(uint8_t const instance_num);
+
+} rotary_encoder_storm_hooks_t;
+
+void rotary_encoder_storm_trip(uint8_t const instance_num);
+#endif
+
+/// Used by the inline interrupt functions below, not to be used directly
+extern rotary_encoder_bank_flags_t rotary_encoder_bank_flags[ROTARY_ENCODER_BANKS];
+extern uint8_t rotary_encoder_instance_bank[ROTARY_ENCODER_INSTANCES];
+#if ROTARY_ENCODER_ISR_STATE
+extern rotary_encoder_isr_state_t rotary_encoder_isr_state[ROTARY_ENCODER_INSTANCES];
+#endif
+
+/// Copy of an instance state taken at one point in time
+typedef struct rotary_encoder_snapshot
+{
+    int16_t knob_value;         /// Relative knob turn value
+    bool b_switch_value;        /// Switch value
+    bool b_event_occured;       /// Event pending, not cleared by the copy
+    bool b_alert_occured;       /// Alert pending, not cleared by the copy
+
+#if ROTARY_ENCODER_SLEW
+    int16_t output_value;       /// Knob value after the slew rate limit
+#endif
+
+} rotary_encoder_snapshot_t;
+
+/// One entry of a board table for rotary_encoder_init_all(), can be const
+typedef struct rotary_encoder_config
+{
+    int16_t min_value;          /// Min value the knob can report
+    int16_t max_value;          /// Max value the knob can report
+    bool b_step_on;             /// Step on max/min, or allow rollover
+    bool b_cw_rot_pos;          /// True if clockwise rotation is positive
+    uint8_t bank_num;           /// Bank the instance runs in
+
+} rotary_encoder_config_t;
+
+#if ROTARY_ENCODER_PARAMS
+/// A value an instance can be bound to, one per parameter on a page
+typedef struct rotary_encoder_param
+{
+    int16_t value;              /// Value, kept while bound
+    int16_t min_value;          /// Min value of the parameter
+    int16_t max_value;          /// Max value of the parameter
+    bool b_step_on;             /// Step on max/min, or allow rollover
+
+} rotary_encoder_param_t;
+#endif
+
+#if ROTARY_ENCODER_FRAMES
+/// State of every instance as of the end of one task call
+typedef struct rotary_encoder_frame
+{
+    uint32_t frame_num;         /// Incremented on every publish
+    rotary_encoder_snapshot_t instance[ROTARY_ENCODER_INSTANCES];
+
+} rotary_encoder_frame_t;
+#endif
 
 bool rotary_encoder_init(uint8_t const instance_num,
                          int16_t const min_value,
                          int16_t const max_value,
                          bool    const step_on,
                          bool    const cw_rot_pos);
+bool rotary_encoder_init_all(rotary_encoder_config_t const * const p_cfg_arr,
+                             uint8_t const count);
 
 bool rotary_encoder_get_switch_value(uint8_t const instance_num);
 int16_t rotary_encoder_get_knob_value(uint8_t const instance_num);
+bool rotary_encoder_get_snapshot(uint8_t const instance_num,
+                                 rotary_encoder_snapshot_t * const p_snapshot);
 
 bool rotary_encoder_set_knob_value(uint8_t const instance_num,
                                    int16_t const value);
@@ -46,8 +245,304 @@ bool rotary_encoder_tog_switch_value(uint8_t const instance_num);
 bool rotary_encoder_set_flags(uint8_t const instance_num,
                               uint8_t const flag);
 
+#if ROTARY_ENCODER_DELTA_INPUT
+bool rotary_encoder_feed_delta(uint8_t const instance_num,
+                               int16_t const delta,
+                               uint32_t const timestamp);
+#endif
+
+#if ROTARY_ENCODER_GLITCH_FILTER
+bool rotary_encoder_set_min_edge_interval(uint8_t const instance_num,
+                                          uint32_t const interval);
+uint32_t rotary_encoder_get_glitch_count(uint8_t const instance_num);
+#endif
+
+#if ROTARY_ENCODER_STORM_GUARD
+void rotary_encoder_set_storm_hooks(rotary_encoder_storm_hooks_t const * const p_hooks);
+bool rotary_encoder_set_storm_guard(uint8_t const instance_num,
+                                    uint16_t const max_edges,
+                                    uint32_t const window);
+void rotary_encoder_storm_poll(void);
+uint16_t rotary_encoder_get_storm_count(uint8_t const instance_num);
+bool rotary_encoder_get_storm_polled(uint8_t const instance_num);
+#endif
+
+#if ROTARY_ENCODER_NOTIFY_THRESHOLD
+bool rotary_encoder_set_notify_threshold(uint8_t const instance_num,
+                                         uint16_t const threshold);
+#endif
+
+#if ROTARY_ENCODER_REVERSAL_FILTER
+bool rotary_encoder_set_reversal_filter(uint8_t const instance_num,
+                                        uint8_t const events,
+                                        uint32_t const dwell);
+#endif
+
+#if ROTARY_ENCODER_INERTIA
+bool rotary_encoder_set_inertia(uint8_t const instance_num,
+                                uint16_t const min_velocity,
+                                uint8_t const decay);
+bool rotary_encoder_get_coasting(uint8_t const instance_num);
+#endif
+
+#if ROTARY_ENCODER_SLEW
+bool rotary_encoder_set_slew_rate(uint8_t const instance_num,
+                                  uint16_t const rate);
+int16_t rotary_encoder_get_output_value(uint8_t const instance_num);
+#endif
+
+#if ROTARY_ENCODER_PARAMS
+bool rotary_encoder_bind_param(uint8_t const instance_num,
+                               rotary_encoder_param_t * const p_param,
+                               bool const b_takeover);
+bool rotary_encoder_get_param_picked_up(uint8_t const instance_num);
+#endif
+
+bool rotary_encoder_set_bank(uint8_t const instance_num,
+                             uint8_t const bank_num);
+uint8_t rotary_encoder_get_bank(uint8_t const instance_num);
+
+#if ROTARY_ENCODER_FRAMES
+rotary_encoder_frame_t const * rotary_encoder_get_frame(void);
+bool rotary_encoder_copy_frame(rotary_encoder_frame_t * const p_frame);
+#endif
+
+#if ROTARY_ENCODER_WATCHDOG
+/// Called when work waited longer than the watchdog threshold
+typedef void (*rotary_encoder_watchdog_hook_t)(uint8_t const instance_num,
+                                               uint32_t const age);
+
+void rotary_encoder_set_watchdog(uint32_t const threshold,
+                                 rotary_encoder_watchdog_hook_t const hook);
+uint32_t rotary_encoder_watchdog_check(void);
+uint32_t rotary_encoder_get_max_pending_age(void);
+#endif
+
+#if ROTARY_ENCODER_COST_BUDGET
+/// Called when handling an instance event took longer than the budget
+typedef void (*rotary_encoder_cost_hook_t)(uint8_t const instance_num,
+                                           uint32_t const cost);
+
+void rotary_encoder_set_cost_budget(uint32_t const budget,
+                                    rotary_encoder_cost_hook_t const hook);
+uint32_t rotary_encoder_get_max_cost(void);
+#endif
+
+#if ROTARY_ENCODER_SELF_CHECK
+bool rotary_encoder_check_invariants(void);
+#endif
+
+#if ROTARY_ENCODER_PASS_HOOKS
+/// Called with the instances changed by a task call, each bit is the instance
+typedef void (*rotary_encoder_pass_hook_t)(uint32_t const changed_flags);
+
+bool rotary_encoder_add_pass_hook(rotary_encoder_pass_hook_t const hook);
+bool rotary_encoder_remove_pass_hook(rotary_encoder_pass_hook_t const hook);
+#endif
+
 bool rotary_encoder_check_event(uint8_t const instance_num);
 bool rotary_encoder_check_alert(uint8_t const instance_num);
+#if ROTARY_ENCODER_LATENCY
+uint32_t rotary_encoder_get_latency(uint8_t const percentile);
+uint32_t rotary_encoder_get_latency_max(void);
+void rotary_encoder_reset_latency(void);
+#endif
+#if ROTARY_ENCODER_ALERT_BITS
+uint32_t rotary_encoder_take_alerts(uint8_t * const p_bits_arr,
+                                    uint16_t * const p_count_arr);
+#endif
 void rotary_encoder_task(void);
+#if ROTARY_ENCODER_TASK_BUDGET
+bool rotary_encoder_task_budget(uint8_t const max_instances);
+#endif
+bool rotary_encoder_task_bank(uint8_t const bank_num);
+void rotary_encoder_publish(void);
+
+/// Get the interrupt flags of the bank an instance is assigned to
+/// @param instance_num Instance number, must be valid
+/// @return The bank flags
+static inline rotary_encoder_bank_flags_t * rotary_encoder_isr_bank(uint8_t const instance_num)
+{
+#if ROTARY_ENCODER_BANKS > 1u
+    return &rotary_encoder_bank_flags[rotary_encoder_instance_bank[instance_num]];
+#else
+    (void)instance_num;
+    return &rotary_encoder_bank_flags[0];
+#endif
+}
+
+/// Set the bit of an instance in an interrupt flags word
+/// @param p_word       Flags word to set the bit in
+/// @param instance_num Instance number, must be valid
+static inline void rotary_encoder_isr_flag(rotary_encoder_flag_word_t * const p_word,
+                                           uint8_t const instance_num)
+{
+#if ROTARY_ENCODER_ATOMIC_FLAGS
+    atomic_fetch_or_explicit(p_word, (1u << instance_num), memory_order_release);
+#else
+    *p_word |= (1u << instance_num);
+#endif
+}
+
+/// Get the instances of a bank with work the task has not handled
+/// Flags the task has not taken yet, and with an event time those it took but
+/// put off, for example under rotary_encoder_task_budget().
+/// @param p_bank Interrupt flags of the bank
+/// @return Bit mask of the instances with work waiting
+static inline uint32_t rotary_encoder_isr_pending(rotary_encoder_bank_flags_t * const p_bank)
+{
+#if ROTARY_ENCODER_ATOMIC_FLAGS
+    uint32_t pending_flags =
+            atomic_load_explicit(&p_bank->cw_flags, memory_order_relaxed) |
+            atomic_load_explicit(&p_bank->ccw_flags, memory_order_relaxed) |
+            atomic_load_explicit(&p_bank->sw_flags, memory_order_relaxed);
+#if ROTARY_ENCODER_DELTA_INPUT
+    pending_flags |= atomic_load_explicit(&p_bank->delta_flags, memory_order_relaxed);
+#endif
+#if ROTARY_ENCODER_EVENT_TIME
+    pending_flags |= atomic_load_explicit(&p_bank->held_flags, memory_order_relaxed);
+#endif
+#else
+    uint32_t pending_flags = p_bank->cw_flags | p_bank->ccw_flags | p_bank->sw_flags;
+#if ROTARY_ENCODER_DELTA_INPUT
+    pending_flags |= p_bank->delta_flags;
+#endif
+#if ROTARY_ENCODER_EVENT_TIME
+    pending_flags |= p_bank->held_flags;
+#endif
+#endif
+
+    return pending_flags;
+}
+
+/// Record the time an instance gets its first work since the task handled it
+/// @param p_bank       Interrupt flags of the instance bank
+/// @param instance_num Instance number, must be valid
+/// @return True if the time was recorded, false if flags were already pending
+static inline bool rotary_encoder_isr_stamp(rotary_encoder_bank_flags_t * const p_bank,
+                                            uint8_t const instance_num)
+{
+    bool b_first = false;
+
+#if ROTARY_ENCODER_EVENT_TIME
+    // Set before the flag, which publishes it to the task
+    b_first = (0u == (rotary_encoder_isr_pending(p_bank) & (1u << instance_num)));
+
+    if(b_first)
+    {
+        rotary_encoder_isr_state[instance_num].event_time =
+                (uint32_t)ROTARY_ENCODER_TIMESTAMP();
+    }
+#else
+    (void)p_bank;
+    (void)instance_num;
+#endif
+
+    return b_first;
+}
+
+/// Check if a knob edge should be kept, or dropped as a glitch
+/// Also counts the edge for the storm guard, tripping it if there are too many
+/// @param instance_num Instance number, must be valid
+/// @return True to keep the edge, always true without the glitch filter
+static inline bool rotary_encoder_isr_edge(uint8_t const instance_num)
+{
+#if ROTARY_ENCODER_GLITCH_FILTER || ROTARY_ENCODER_STORM_GUARD || \
+    ROTARY_ENCODER_REVERSAL_FILTER
+    rotary_encoder_isr_state_t * const p_state = &rotary_encoder_isr_state[instance_num];
+    uint32_t const now = (uint32_t)ROTARY_ENCODER_TIMESTAMP();
+#endif
+
+#if ROTARY_ENCODER_STORM_GUARD
+    if(ROTARY_ENCODER_TIMESTAMP_DIFF(now, p_state->storm_window_start) >=
+       p_state->storm_window)
+    {
+        p_state->storm_window_start = now;
+        p_state->storm_edges = 0;
+    }
+
+    if(UINT16_MAX != p_state->storm_edges)
+    {
+        ++p_state->storm_edges;
+    }
+
+    if((0u != p_state->storm_window) &&
+       (p_state->storm_edges > p_state->storm_max_edges) &&
+       !p_state->b_storm_polled)
+    {
+        rotary_encoder_storm_trip(instance_num);
+    }
+#endif
+
+#if ROTARY_ENCODER_GLITCH_FILTER
+    bool const b_keep = (ROTARY_ENCODER_TIMESTAMP_DIFF(now, p_state->last_edge_time) >=
+                         p_state->min_edge_interval);
+
+    if(b_keep)
+    {
+        p_state->last_edge_time = now;
+    }
+    else
+    {
+        ++p_state->glitch_count;
+    }
+
+    return b_keep;
+#else
+
+#if ROTARY_ENCODER_REVERSAL_FILTER
+    p_state->last_edge_time = now;
+#endif
+
+    (void)instance_num;
+    return true;
+#endif
+}
+
+/// Interrupt fast path for a clockwise turn, inlined into the interrupt
+/// Same as rotary_encoder_set_flags() without any checks, so instance_num must
+/// be an initialized instance.  With a constant instance_num this compiles to
+/// one OR of a constant into the bank flags word.
+/// @param instance_num Instance number of encoder flags to set
+/// @return True if flags were set, false if dropped by the glitch filter
+static inline bool rotary_encoder_isr_cw(uint8_t const instance_num)
+{
+    bool const b_keep = rotary_encoder_isr_edge(instance_num);
+
+    if(b_keep)
+    {
+        rotary_encoder_isr_stamp(rotary_encoder_isr_bank(instance_num), instance_num);
+        rotary_encoder_isr_flag(&rotary_encoder_isr_bank(instance_num)->cw_flags,
+                                instance_num);
+    }
+
+    return b_keep;
+}
+
+/// Interrupt fast path for a counter clockwise turn, see rotary_encoder_isr_cw()
+/// @param instance_num Instance number of encoder flags to set
+/// @return True if flags were set, false if dropped by the glitch filter
+static inline bool rotary_encoder_isr_ccw(uint8_t const instance_num)
+{
+    bool const b_keep = rotary_encoder_isr_edge(instance_num);
+
+    if(b_keep)
+    {
+        rotary_encoder_isr_stamp(rotary_encoder_isr_bank(instance_num), instance_num);
+        rotary_encoder_isr_flag(&rotary_encoder_isr_bank(instance_num)->ccw_flags,
+                                instance_num);
+    }
+
+    return b_keep;
+}
+
+/// Interrupt fast path for a switch press, see rotary_encoder_isr_cw()
+/// @param instance_num Instance number of encoder flags to set
+static inline void rotary_encoder_isr_sw(uint8_t const instance_num)
+{
+    rotary_encoder_isr_stamp(rotary_encoder_isr_bank(instance_num), instance_num);
+    rotary_encoder_isr_flag(&rotary_encoder_isr_bank(instance_num)->sw_flags,
+                            instance_num);
+}
 
 #endif /* ROTARY_ENCODERS_H_ */
@@ -0,0 +1,208 @@
+///
+/// rotary_encoders configuration
+///
+/// Every option of the rotary_encoders module, with its default.
+/// Each can be changed here, passed on the compiler command line, or set in a
+/// project header named by ROTARY_ENCODER_CONFIG_FILE, for example
+///     -DROTARY_ENCODER_CONFIG_FILE=\"board_encoders.h\"
+///
+/// An option that is off adds no RAM or flash of its own.  The base module
+/// with every option off still has more than the plain knob: table init,
+/// snapshots, banks and publish are always built, which took -Os x86-64 text
+/// from 1128 to about 1860 bytes.  The RAM noted for each option is on top
+/// of the base module; see tools/size_report.sh to measure flash and RAM of
+/// each option for your compiler and target.
+///
+
+#ifndef ROTARY_ENCODERS_CONFIG_H_
+#define ROTARY_ENCODERS_CONFIG_H_
+
+#ifdef ROTARY_ENCODER_CONFIG_FILE
+#include ROTARY_ENCODER_CONFIG_FILE
+#endif
+
+/// Max number of instances this program supports
+/// Increase or decrease for your needs
+/// Can be up to 32 before having to change code
+/// RAM: about 15 bytes per instance
+#ifndef ROTARY_ENCODER_INSTANCES
+#define ROTARY_ENCODER_INSTANCES 4u
+#endif
+
+/// Set to 1 if other threads or cores read instance values while
+/// rotary_encoder_task() runs.  Each instance gets a sequence lock so readers
+/// never see a half written update, and never block the task.
+/// Requires C11 atomics.
+/// RAM: 4 bytes per instance
+#ifndef ROTARY_ENCODER_MULTI_READER
+#define ROTARY_ENCODER_MULTI_READER 0u
+#endif
+
+/// Number of frame buffers for rotary_encoder_get_frame(), 0 to disable.
+/// The task copies every instance into a back frame at the end of each call
+/// that changed something, then publishes it with one atomic pointer store.
+/// Use at least 2, 3 gives readers a full task call to copy a frame.
+/// Requires C11 atomics.
+/// RAM: ROTARY_ENCODER_FRAMES * (12 + 10 * ROTARY_ENCODER_INSTANCES) bytes,
+///      4 more per instance and frame with ROTARY_ENCODER_SLEW
+#ifndef ROTARY_ENCODER_FRAMES
+#define ROTARY_ENCODER_FRAMES 0u
+#endif
+
+/// Number of functions that can be told what changed after each task call,
+/// 0 to disable.  Used by exporters such as rotary_encoders_shm.
+/// RAM: one function pointer per hook
+#ifndef ROTARY_ENCODER_PASS_HOOKS
+#define ROTARY_ENCODER_PASS_HOOKS 0u
+#endif
+
+/// Number of banks instances can be assigned to, one per core is typical.
+/// Each bank has its own interrupt flags, aligned to ROTARY_ENCODER_CACHE_LINE,
+/// and its own task function.  More than 1 needs ROTARY_ENCODER_MULTI_READER.
+/// RAM: 2 cache lines per bank when more than 1
+#ifndef ROTARY_ENCODER_BANKS
+#define ROTARY_ENCODER_BANKS 1u
+#endif
+
+/// Cache line size in bytes of the target, used to keep banks apart
+#ifndef ROTARY_ENCODER_CACHE_LINE
+#define ROTARY_ENCODER_CACHE_LINE 64u
+#endif
+
+/// Set to 1 to keep what interrupts write off the cache lines the task and
+/// readers use.  Flags words, task state and each instance, with its interrupt
+/// state and delta accumulator, all start on their own cache line.  Costs up
+/// to 3 * ROTARY_ENCODER_CACHE_LINE bytes per instance and one per bank, worth
+/// it on multi-core hosts, not on single core MCUs.
+#ifndef ROTARY_ENCODER_PADDED_LAYOUT
+#define ROTARY_ENCODER_PADDED_LAYOUT 0u
+#endif
+
+/// Set to 1 to set and clear interrupt flags with C11 atomics.  Needed when
+/// interrupts on one core flag a bank handled by a task on another, or when
+/// nested interrupts flag the same bank.  Requires C11 atomics.
+#ifndef ROTARY_ENCODER_ATOMIC_FLAGS
+#define ROTARY_ENCODER_ATOMIC_FLAGS 0u
+#endif
+
+/// Set to 1 for rotary_encoder_task_budget(), a task call with a bounded
+/// amount of work that resumes where it left off.
+/// RAM: 1 byte
+#ifndef ROTARY_ENCODER_TASK_BUDGET
+#define ROTARY_ENCODER_TASK_BUDGET 0u
+#endif
+
+/// Timestamp source for the options that time edges, read in interrupts.
+/// Define it as something cheap such as a free running timer count, e.g.
+///     #define ROTARY_ENCODER_TIMESTAMP() (DWT->CYCCNT)
+/// Not defined by default, options that need it fail to build without it.
+// #define ROTARY_ENCODER_TIMESTAMP() (0u)
+
+/// Number of bits ROTARY_ENCODER_TIMESTAMP() counts before wrapping, 32 max
+#ifndef ROTARY_ENCODER_TIMESTAMP_BITS
+#define ROTARY_ENCODER_TIMESTAMP_BITS 32u
+#endif
+
+/// Set to 1 to drop knob edges that come sooner than a minimum interval after
+/// the last accepted one, see rotary_encoder_set_min_edge_interval().
+/// Costs one timestamp read, subtract and compare per interrupt.
+/// Needs ROTARY_ENCODER_TIMESTAMP().
+/// RAM: 12 bytes per instance
+#ifndef ROTARY_ENCODER_GLITCH_FILTER
+#define ROTARY_ENCODER_GLITCH_FILTER 0u
+#endif
+
+/// Set to 1 to guard against interrupt storms from a failing encoder or EMI.
+/// Each knob edge is counted, and an instance with too many edges in a time
+/// window has its interrupt masked and is polled from a timer until the rate
+/// drops, see rotary_encoder_set_storm_guard().
+/// Needs ROTARY_ENCODER_TIMESTAMP().
+/// RAM: 16 bytes per instance
+#ifndef ROTARY_ENCODER_STORM_GUARD
+#define ROTARY_ENCODER_STORM_GUARD 0u
+#endif
+
+/// Set to 1 to filter single backward steps from contact bounce at speed.
+/// While the knob turns fast, a change of direction needs several events in
+/// a row or a pause before it is taken, see rotary_encoder_set_reversal_filter().
+/// Needs ROTARY_ENCODER_TIMESTAMP().
+/// RAM: 26 bytes per instance
+#ifndef ROTARY_ENCODER_REVERSAL_FILTER
+#define ROTARY_ENCODER_REVERSAL_FILTER 0u
+#endif
+
+/// Set to 1 to let a fast flick keep the knob value moving, slowing down
+/// every task call, see rotary_encoder_set_inertia().
+/// RAM: 16 bytes per instance, 8 bytes per bank
+#ifndef ROTARY_ENCODER_INERTIA
+#define ROTARY_ENCODER_INERTIA 0u
+#endif
+
+/// Set to 1 for an output value that follows the knob value at a limited
+/// rate per task call, see rotary_encoder_set_slew_rate().
+/// RAM: 4 bytes per instance, 4 bytes per bank, 2 bytes per frame instance
+#ifndef ROTARY_ENCODER_SLEW
+#define ROTARY_ENCODER_SLEW 0u
+#endif
+
+/// Set to 1 to bind an instance to any of many parameters, each with its own
+/// value and bounds, see rotary_encoder_bind_param().
+/// RAM: 18 bytes per instance on x86-64 with padding, less on 32 bit
+#ifndef ROTARY_ENCODER_PARAMS
+#define ROTARY_ENCODER_PARAMS 0u
+#endif
+
+/// Set to 1 to feed relative input other than encoder flags, such as touch
+/// sliders or mouse wheels, see rotary_encoder_feed_delta().
+/// RAM: 12 bytes per instance, 8 bytes per bank
+#ifndef ROTARY_ENCODER_DELTA_INPUT
+#define ROTARY_ENCODER_DELTA_INPUT 0u
+#endif
+
+/// Set to 1 to record which bound was hit and how, with a count, for every
+/// instance, see rotary_encoder_take_alerts().
+/// RAM: 4 bytes per instance
+#ifndef ROTARY_ENCODER_ALERT_BITS
+#define ROTARY_ENCODER_ALERT_BITS 0u
+#endif
+
+/// Set to 1 to only notify knob moves of at least a threshold since the last
+/// notification, see rotary_encoder_set_notify_threshold().
+/// RAM: 4 bytes per instance
+#ifndef ROTARY_ENCODER_NOTIFY_THRESHOLD
+#define ROTARY_ENCODER_NOTIFY_THRESHOLD 0u
+#endif
+
+/// Set to 1 to measure the time from the first interrupt of an event to the
+/// application reading it, see rotary_encoder_get_latency().
+/// Needs ROTARY_ENCODER_TIMESTAMP().
+/// RAM: 12 bytes per instance, 140 bytes per bank
+#ifndef ROTARY_ENCODER_LATENCY
+#define ROTARY_ENCODER_LATENCY 0u
+#endif
+
+/// Set to 1 to detect rotary_encoder_task() not being called in time, see
+/// rotary_encoder_watchdog_check().  Needs ROTARY_ENCODER_TIMESTAMP().
+/// RAM: 4 bytes per instance, 20 bytes
+#ifndef ROTARY_ENCODER_WATCHDOG
+#define ROTARY_ENCODER_WATCHDOG 0u
+#endif
+
+/// Set to 1 in debug builds to check every knob move against a slow
+/// reference model that takes one plain step at a time.  A mismatch, or a
+/// value left outside its bounds, fails ROTARY_ENCODER_ASSERT(), which is
+/// assert() unless defined before this file.
+/// RAM: none, flash and a loop per move of up to the move size
+#ifndef ROTARY_ENCODER_SELF_CHECK
+#define ROTARY_ENCODER_SELF_CHECK 0u
+#endif
+
+/// Set to 1 to time the handling of every instance event against a budget,
+/// see rotary_encoder_set_cost_budget().  Needs ROTARY_ENCODER_TIMESTAMP(),
+/// define it as a cycle counter to measure in cycles.
+/// RAM: 4 bytes per bank, 12 bytes
+#ifndef ROTARY_ENCODER_COST_BUDGET
+#define ROTARY_ENCODER_COST_BUDGET 0u
+#endif
+
+#endif /* ROTARY_ENCODERS_CONFIG_H_ */
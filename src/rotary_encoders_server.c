@@ -0,0 +1,292 @@
+///
+/// rotary_encoders_server module
+///
+/// Publishes rotary_encoders changes over a Unix domain socket, one batched
+/// frame per task call, to any number of subscribers using epoll.
+///
+/// Call every function here from the thread that runs rotary_encoder_task().
+///
+#define _GNU_SOURCE
+
+#include "rotary_encoders_server.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#if (0u == ROTARY_ENCODER_PASS_HOOKS)
+#error "rotary_encoders_server needs ROTARY_ENCODER_PASS_HOOKS >= 1"
+#endif
+
+/// Listening socket, -1 when closed
+static int listen_fd = -1;
+
+/// Epoll set holding the listening socket and every subscriber
+static int epoll_fd = -1;
+
+/// Subscriber sockets, -1 for unused slots, only valid while open
+static int client_fd_arr[ROTARY_ENCODER_SERVER_CLIENTS] = {0};
+
+/// Number of frames sent, used as the next frame number
+static uint32_t frame_num = 0;
+
+/// Frames a subscriber missed because its socket buffer was full
+static uint32_t dropped_count = 0;
+
+/// Path given to rotary_encoder_server_open(), used to unlink on close
+static char server_path[sizeof(((struct sockaddr_un *)0)->sun_path)] = {0};
+
+static void rotary_encoder_server_update(uint32_t const changed_flags);
+static void rotary_encoder_server_accept(void);
+static void rotary_encoder_server_drop_client(uint8_t const client_num);
+
+/// Create the socket and start publishing frames on it
+/// @param p_path File system path of the socket, replaced if it exists
+/// @return True on success, false on error
+bool rotary_encoder_server_open(char const * const p_path)
+{
+    bool b_status = false;
+
+    if((-1 == listen_fd) &&
+       (0 != p_path) &&
+       (sizeof(server_path) > strlen(p_path)))
+    {
+        struct sockaddr_un addr = {0};
+
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, p_path);
+        strcpy(server_path, p_path);
+
+        for(uint8_t i = 0; i < ROTARY_ENCODER_SERVER_CLIENTS; i++)
+        {
+            client_fd_arr[i] = -1;
+        }
+
+        listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+        unlink(p_path);
+
+        if((0 <= listen_fd) &&
+           (0 <= epoll_fd) &&
+           (0 == bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr))) &&
+           (0 == listen(listen_fd, ROTARY_ENCODER_SERVER_CLIENTS)))
+        {
+            struct epoll_event ev = {0};
+
+            ev.events = EPOLLIN;
+            ev.data.fd = listen_fd;
+
+            b_status = (0 == epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev)) &&
+                       rotary_encoder_add_pass_hook(rotary_encoder_server_update);
+        }
+
+        if(!b_status)
+        {
+            rotary_encoder_server_close();
+        }
+    }
+
+    return b_status;
+}
+
+/// Stop publishing, disconnect every subscriber and remove the socket
+void rotary_encoder_server_close(void)
+{
+    // Subscriber slots are only set up once open got this far
+    if((0 <= listen_fd) || (0 <= epoll_fd))
+    {
+        rotary_encoder_remove_pass_hook(rotary_encoder_server_update);
+
+        for(uint8_t i = 0; i < ROTARY_ENCODER_SERVER_CLIENTS; i++)
+        {
+            rotary_encoder_server_drop_client(i);
+        }
+
+        if(0 <= listen_fd)
+        {
+            close(listen_fd);
+            unlink(server_path);
+        }
+
+        if(0 <= epoll_fd)
+        {
+            close(epoll_fd);
+        }
+
+        listen_fd = -1;
+        epoll_fd = -1;
+        server_path[0] = '\0';
+    }
+}
+
+/// Get the epoll descriptor, readable when rotary_encoder_server_poll() has
+/// work to do.  Add it to an outer event loop instead of polling with a timeout.
+/// @return The epoll descriptor, -1 if the server is not open
+int rotary_encoder_server_get_fd(void)
+{
+    return epoll_fd;
+}
+
+/// Accept new subscribers and remove the ones that hung up
+/// @param timeout_ms Max time to wait for activity, 0 to return at once,
+///                   -1 to wait forever
+void rotary_encoder_server_poll(int const timeout_ms)
+{
+    struct epoll_event ev_arr[ROTARY_ENCODER_SERVER_CLIENTS + 1u];
+    int const count = (0 <= epoll_fd) ?
+                      epoll_wait(epoll_fd, ev_arr,
+                                 ROTARY_ENCODER_SERVER_CLIENTS + 1u,
+                                 timeout_ms) :
+                      0;
+
+    for(int n = 0; n < count; n++)
+    {
+        if(listen_fd == ev_arr[n].data.fd)
+        {
+            rotary_encoder_server_accept();
+        }
+        else
+        {
+            // Subscribers never send, so readable means hung up or misbehaving
+            for(uint8_t i = 0; i < ROTARY_ENCODER_SERVER_CLIENTS; i++)
+            {
+                if(client_fd_arr[i] == ev_arr[n].data.fd)
+                {
+                    rotary_encoder_server_drop_client(i);
+                }
+            }
+        }
+    }
+}
+
+/// Get the number of subscribers connected
+/// @return Number of subscribers
+uint8_t rotary_encoder_server_get_client_count(void)
+{
+    uint8_t count = 0;
+
+    for(uint8_t i = 0; (i < ROTARY_ENCODER_SERVER_CLIENTS) && (0 <= listen_fd); i++)
+    {
+        count += (0 <= client_fd_arr[i]) ? 1u : 0u;
+    }
+
+    return count;
+}
+
+/// Get the number of frames not delivered because a subscriber was too slow
+/// @return Frames dropped, summed over all subscribers
+uint32_t rotary_encoder_server_get_dropped_count(void)
+{
+    return dropped_count;
+}
+
+/// Pass hook, sends every change from one task call as one frame
+/// @param changed_flags Instances changed by the task call
+static void rotary_encoder_server_update(uint32_t const changed_flags)
+{
+    uint8_t frame[ROTARY_ENCODER_SERVER_FRAME_MAX];
+    uint16_t frame_len = ROTARY_ENCODER_SERVER_HEADER_LEN;
+    uint8_t record_count = 0;
+
+    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+    {
+        rotary_encoder_snapshot_t snapshot;
+
+        if((0u != (changed_flags & (1u << i))) &&
+           rotary_encoder_get_snapshot(i, &snapshot))
+        {
+            uint8_t const state =
+                    (snapshot.b_switch_value  ? ROTARY_ENCODER_SERVER_STATE_SW : 0u) |
+                    (snapshot.b_event_occured ? ROTARY_ENCODER_SERVER_STATE_EVENT : 0u) |
+                    (snapshot.b_alert_occured ? ROTARY_ENCODER_SERVER_STATE_ALERT : 0u);
+
+            frame[frame_len + 0u] = i;
+            frame[frame_len + 1u] = state;
+            memcpy(&frame[frame_len + 2u], &snapshot.knob_value,
+                   sizeof(snapshot.knob_value));
+
+            frame_len += ROTARY_ENCODER_SERVER_RECORD_LEN;
+            ++record_count;
+        }
+    }
+
+    if(0u != record_count)
+    {
+        uint8_t const version = ROTARY_ENCODER_SERVER_VERSION;
+
+        memcpy(&frame[0], &frame_len, sizeof(frame_len));
+        frame[2] = version;
+        frame[3] = record_count;
+        memcpy(&frame[4], &frame_num, sizeof(frame_num));
+
+        ++frame_num;
+
+        // One write per subscriber, SOCK_SEQPACKET never splits it
+        for(uint8_t i = 0; i < ROTARY_ENCODER_SERVER_CLIENTS; i++)
+        {
+            if((0 <= client_fd_arr[i]) &&
+               (0 > send(client_fd_arr[i], frame, frame_len,
+                         MSG_DONTWAIT | MSG_NOSIGNAL)))
+            {
+                if((EAGAIN == errno) || (EWOULDBLOCK == errno))
+                {
+                    // Slow subscriber, it sees a gap in frame_num
+                    ++dropped_count;
+                }
+                else
+                {
+                    rotary_encoder_server_drop_client(i);
+                }
+            }
+        }
+    }
+}
+
+/// Accept every pending connection while there is a free subscriber slot
+static void rotary_encoder_server_accept(void)
+{
+    int fd;
+
+    while(0 <= (fd = accept4(listen_fd, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC)))
+    {
+        bool b_added = false;
+
+        for(uint8_t i = 0; (i < ROTARY_ENCODER_SERVER_CLIENTS) && !b_added; i++)
+        {
+            if(0 > client_fd_arr[i])
+            {
+                struct epoll_event ev = {0};
+
+                ev.events = EPOLLIN | EPOLLRDHUP;
+                ev.data.fd = fd;
+
+                if(0 == epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev))
+                {
+                    client_fd_arr[i] = fd;
+                    b_added = true;
+                }
+            }
+        }
+
+        if(!b_added)
+        {
+            close(fd);
+        }
+    }
+}
+
+/// Disconnect one subscriber and free its slot
+/// @param client_num Slot of the subscriber
+static void rotary_encoder_server_drop_client(uint8_t const client_num)
+{
+    if(0 <= client_fd_arr[client_num])
+    {
+        // Closing also removes it from the epoll set
+        close(client_fd_arr[client_num]);
+        client_fd_arr[client_num] = -1;
+    }
+}
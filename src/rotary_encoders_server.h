@@ -0,0 +1,61 @@
+///
+/// rotary_encoders_server module
+///
+/// Publishes rotary_encoders changes over a Unix domain socket for processes
+/// that can not map rotary_encoders_shm.
+///
+/// Every rotary_encoder_task() call that changed something sends one frame to
+/// every subscriber.  The socket is SOCK_SEQPACKET so each frame arrives whole
+/// in one read.  All fields are in host byte order, this is local only.
+///
+/// Frame layout:
+///   uint16_t frame_len      Bytes in the frame, header included
+///   uint8_t  version        ROTARY_ENCODER_SERVER_VERSION
+///   uint8_t  record_count   Number of records that follow
+///   uint32_t frame_num      Incremented per frame, gaps mean dropped frames
+///   Then record_count records of ROTARY_ENCODER_SERVER_RECORD_LEN bytes:
+///   uint8_t  instance_num
+///   uint8_t  state          ROTARY_ENCODER_SERVER_STATE_* bits
+///   int16_t  knob_value
+///
+/// Linux only, needs ROTARY_ENCODER_PASS_HOOKS >= 1.
+///
+
+#ifndef ROTARY_ENCODERS_SERVER_H_
+#define ROTARY_ENCODERS_SERVER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rotary_encoders.h"
+
+/// Frame version, bumped on any change to the frame layout
+#define ROTARY_ENCODER_SERVER_VERSION 1u
+
+/// Max number of subscribers connected at once
+#define ROTARY_ENCODER_SERVER_CLIENTS 16u
+
+/// Frame header and record sizes in bytes
+#define ROTARY_ENCODER_SERVER_HEADER_LEN 8u
+#define ROTARY_ENCODER_SERVER_RECORD_LEN 4u
+
+/// Largest frame, one record per instance
+#define ROTARY_ENCODER_SERVER_FRAME_MAX   (ROTARY_ENCODER_SERVER_HEADER_LEN + \
+                                           (ROTARY_ENCODER_SERVER_RECORD_LEN * \
+                                            ROTARY_ENCODER_INSTANCES))
+
+/// Bits of the record state byte
+#define ROTARY_ENCODER_SERVER_STATE_SW    0x01u
+#define ROTARY_ENCODER_SERVER_STATE_EVENT 0x02u
+#define ROTARY_ENCODER_SERVER_STATE_ALERT 0x04u
+
+bool rotary_encoder_server_open(char const * const p_path);
+void rotary_encoder_server_close(void);
+
+int rotary_encoder_server_get_fd(void);
+void rotary_encoder_server_poll(int const timeout_ms);
+
+uint8_t rotary_encoder_server_get_client_count(void);
+uint32_t rotary_encoder_server_get_dropped_count(void);
+
+#endif /* ROTARY_ENCODERS_SERVER_H_ */
@@ -0,0 +1,314 @@
+///
+/// rotary_encoders_shm module
+///
+/// Exports rotary_encoders state to a POSIX shared memory segment so other
+/// processes can read knob values without any IPC round trips.
+///
+/// Link with -lrt on older glibc.
+///
+#define _POSIX_C_SOURCE 200809L
+
+#include "rotary_encoders_shm.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if (0u == ROTARY_ENCODER_PASS_HOOKS)
+#error "rotary_encoders_shm needs ROTARY_ENCODER_PASS_HOOKS >= 1"
+#endif
+
+/// Segment mapped by rotary_encoder_shm_open(), null when closed
+static rotary_encoder_shm_t * p_export = 0;
+
+/// Name given to rotary_encoder_shm_open(), used to unlink on close
+static char export_name[64] = {0};
+
+static void rotary_encoder_shm_update(uint32_t const changed_flags);
+static void rotary_encoder_shm_write_instance(uint8_t const instance_num,
+                                              rotary_encoder_snapshot_t const * const p_snapshot);
+static void rotary_encoder_shm_write_event(uint8_t const instance_num,
+                                           rotary_encoder_snapshot_t const * const p_snapshot);
+
+/// Create the shared memory segment and start exporting to it
+/// Call from the thread that runs rotary_encoder_task()
+/// @param p_name Segment name, "/name" as for shm_open()
+/// @return True on success, false on error
+bool rotary_encoder_shm_open(char const * const p_name)
+{
+    bool b_status = false;
+
+    if((0 == p_export) &&
+       (0 != p_name) &&
+       (sizeof(export_name) > strlen(p_name)))
+    {
+        int const fd = shm_open(p_name, O_CREAT | O_RDWR, 0644);
+
+        if(0 <= fd)
+        {
+            void * p_map = MAP_FAILED;
+
+            if(0 == ftruncate(fd, sizeof(rotary_encoder_shm_t)))
+            {
+                p_map = mmap(0, sizeof(rotary_encoder_shm_t),
+                             PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+
+            // The mapping stays valid after the descriptor is closed
+            close(fd);
+
+            if(MAP_FAILED != p_map)
+            {
+                p_export = (rotary_encoder_shm_t *)p_map;
+                strcpy(export_name, p_name);
+
+                // Consumers wait for the magic before trusting anything
+                atomic_store_explicit(&p_export->magic, 0u, memory_order_relaxed);
+                p_export->version = ROTARY_ENCODER_SHM_VERSION;
+                p_export->instance_count = ROTARY_ENCODER_INSTANCES;
+                p_export->ring_size = ROTARY_ENCODER_SHM_RING_SIZE;
+                p_export->snapshot_size = sizeof(rotary_encoder_snapshot_t);
+                atomic_store_explicit(&p_export->event_count, 0u,
+                                      memory_order_relaxed);
+
+                for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+                {
+                    rotary_encoder_snapshot_t snapshot = {0};
+
+                    // Uninitialized instances export as all zero
+                    rotary_encoder_get_snapshot(i, &snapshot);
+
+                    atomic_store_explicit(&p_export->instance[i].seq, 0u,
+                                          memory_order_relaxed);
+                    p_export->instance[i].snapshot = snapshot;
+                }
+
+                for(uint32_t i = 0; i < ROTARY_ENCODER_SHM_RING_SIZE; i++)
+                {
+                    atomic_store_explicit(&p_export->ring[i].event_num, 0u,
+                                          memory_order_relaxed);
+                }
+
+                atomic_store_explicit(&p_export->magic, ROTARY_ENCODER_SHM_MAGIC,
+                                      memory_order_release);
+
+                b_status = rotary_encoder_add_pass_hook(rotary_encoder_shm_update);
+
+                if(!b_status)
+                {
+                    rotary_encoder_shm_close();
+                }
+            }
+            else
+            {
+                shm_unlink(p_name);
+            }
+        }
+    }
+
+    return b_status;
+}
+
+/// Stop exporting and remove the shared memory segment
+/// Consumers still attached keep their mapping until they detach
+void rotary_encoder_shm_close(void)
+{
+    if(0 != p_export)
+    {
+        rotary_encoder_remove_pass_hook(rotary_encoder_shm_update);
+
+        munmap(p_export, sizeof(rotary_encoder_shm_t));
+        shm_unlink(export_name);
+
+        p_export = 0;
+        export_name[0] = '\0';
+    }
+}
+
+/// Map a segment created by rotary_encoder_shm_open() read only
+/// @param p_name Segment name given to rotary_encoder_shm_open()
+/// @return The segment, null if missing, not ready or built differently
+rotary_encoder_shm_t const * rotary_encoder_shm_attach(char const * const p_name)
+{
+    rotary_encoder_shm_t const * p_shm = 0;
+    int const fd = (0 != p_name) ? shm_open(p_name, O_RDONLY, 0) : -1;
+
+    if(0 <= fd)
+    {
+        struct stat st;
+        void * p_map = MAP_FAILED;
+
+        if((0 == fstat(fd, &st)) &&
+           ((off_t)sizeof(rotary_encoder_shm_t) <= st.st_size))
+        {
+            p_map = mmap(0, sizeof(rotary_encoder_shm_t),
+                         PROT_READ, MAP_SHARED, fd, 0);
+        }
+
+        close(fd);
+
+        if(MAP_FAILED != p_map)
+        {
+            p_shm = (rotary_encoder_shm_t const *)p_map;
+
+            bool const b_ready =
+                    (ROTARY_ENCODER_SHM_MAGIC ==
+                     atomic_load_explicit(&p_shm->magic, memory_order_acquire)) &&
+                    (ROTARY_ENCODER_SHM_VERSION == p_shm->version) &&
+                    (ROTARY_ENCODER_INSTANCES == p_shm->instance_count) &&
+                    (ROTARY_ENCODER_SHM_RING_SIZE == p_shm->ring_size) &&
+                    (sizeof(rotary_encoder_snapshot_t) == p_shm->snapshot_size);
+
+            if(!b_ready)
+            {
+                munmap(p_map, sizeof(rotary_encoder_shm_t));
+                p_shm = 0;
+            }
+        }
+    }
+
+    return p_shm;
+}
+
+/// Unmap a segment returned by rotary_encoder_shm_attach()
+/// @param p_shm Segment to unmap
+void rotary_encoder_shm_detach(rotary_encoder_shm_t const * const p_shm)
+{
+    if(0 != p_shm)
+    {
+        munmap((void *)p_shm, sizeof(rotary_encoder_shm_t));
+    }
+}
+
+/// Read a consistent copy of one instance from the segment
+/// @param p_shm        Segment returned by rotary_encoder_shm_attach()
+/// @param instance_num Instance number to read
+/// @param p_snapshot   Where to copy the instance state
+/// @return True on success, false on error
+bool rotary_encoder_shm_read_instance(rotary_encoder_shm_t const * const p_shm,
+                                      uint8_t const instance_num,
+                                      rotary_encoder_snapshot_t * const p_snapshot)
+{
+    bool b_status = false;
+
+    if((0 != p_shm) &&
+       (0 != p_snapshot) &&
+       (ROTARY_ENCODER_INSTANCES > instance_num))
+    {
+        rotary_encoder_shm_instance_t const * const p_inst =
+                &p_shm->instance[instance_num];
+        unsigned seq_start;
+        unsigned seq_end;
+
+        do
+        {
+            seq_start = atomic_load_explicit(&p_inst->seq, memory_order_acquire);
+            *p_snapshot = p_inst->snapshot;
+            atomic_thread_fence(memory_order_acquire);
+            seq_end = atomic_load_explicit(&p_inst->seq, memory_order_relaxed);
+
+        } while((0u != (seq_start & 1u)) || (seq_start != seq_end));
+
+        b_status = true;
+    }
+
+    return b_status;
+}
+
+/// Read one event from the ring
+/// Events are numbered from 0, compare against event_count to find new ones.
+/// An event older than ROTARY_ENCODER_SHM_RING_SIZE events is overwritten.
+/// @param p_shm          Segment returned by rotary_encoder_shm_attach()
+/// @param event_num      Number of the event to read
+/// @param p_instance_num Where to copy the instance number that changed
+/// @param p_snapshot     Where to copy the instance state after the change
+/// @return True on success, false if the event is not written or overwritten
+bool rotary_encoder_shm_read_event(rotary_encoder_shm_t const * const p_shm,
+                                   uint32_t const event_num,
+                                   uint8_t * const p_instance_num,
+                                   rotary_encoder_snapshot_t * const p_snapshot)
+{
+    bool b_status = false;
+
+    if((0 != p_shm) && (0 != p_instance_num) && (0 != p_snapshot))
+    {
+        rotary_encoder_shm_event_t const * const p_event =
+                &p_shm->ring[event_num & (ROTARY_ENCODER_SHM_RING_SIZE - 1u)];
+
+        unsigned const num_start =
+                atomic_load_explicit(&p_event->event_num, memory_order_acquire);
+
+        *p_instance_num = p_event->instance_num;
+        *p_snapshot = p_event->snapshot;
+
+        atomic_thread_fence(memory_order_acquire);
+
+        unsigned const num_end =
+                atomic_load_explicit(&p_event->event_num, memory_order_relaxed);
+
+        // The slot must hold this event from start to end of the copy
+        b_status = ((event_num + 1u) == num_start) && (num_start == num_end);
+    }
+
+    return b_status;
+}
+
+/// Pass hook, copies each changed instance into the table and the ring
+/// @param changed_flags Instances changed by the task call
+static void rotary_encoder_shm_update(uint32_t const changed_flags)
+{
+    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+    {
+        rotary_encoder_snapshot_t snapshot;
+
+        if((0u != (changed_flags & (1u << i))) &&
+           rotary_encoder_get_snapshot(i, &snapshot))
+        {
+            rotary_encoder_shm_write_instance(i, &snapshot);
+            rotary_encoder_shm_write_event(i, &snapshot);
+        }
+    }
+}
+
+/// Write one instance table entry under its sequence lock
+/// @param instance_num Instance number to write
+/// @param p_snapshot   Instance state to write
+static void rotary_encoder_shm_write_instance(uint8_t const instance_num,
+                                              rotary_encoder_snapshot_t const * const p_snapshot)
+{
+    rotary_encoder_shm_instance_t * const p_inst = &p_export->instance[instance_num];
+    unsigned const seq = atomic_load_explicit(&p_inst->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&p_inst->seq, seq + 1u, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    p_inst->snapshot = *p_snapshot;
+
+    atomic_store_explicit(&p_inst->seq, seq + 2u, memory_order_release);
+}
+
+/// Write the next event ring entry
+/// @param instance_num Instance number that changed
+/// @param p_snapshot   Instance state after the change
+static void rotary_encoder_shm_write_event(uint8_t const instance_num,
+                                           rotary_encoder_snapshot_t const * const p_snapshot)
+{
+    unsigned const event_num =
+            atomic_load_explicit(&p_export->event_count, memory_order_relaxed);
+    rotary_encoder_shm_event_t * const p_event =
+            &p_export->ring[event_num & (ROTARY_ENCODER_SHM_RING_SIZE - 1u)];
+
+    // Mark the slot as being written so readers of the old event reject it
+    atomic_store_explicit(&p_event->event_num, 0u, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    p_event->instance_num = instance_num;
+    p_event->snapshot = *p_snapshot;
+
+    atomic_store_explicit(&p_event->event_num, event_num + 1u,
+                          memory_order_release);
+    atomic_store_explicit(&p_export->event_count, event_num + 1u,
+                          memory_order_release);
+}
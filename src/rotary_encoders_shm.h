@@ -0,0 +1,84 @@
+///
+/// rotary_encoders_shm module
+///
+/// Exports rotary_encoders state to a POSIX shared memory segment so other
+/// processes can read knob values without any IPC round trips.
+///
+/// The task process calls rotary_encoder_shm_open() once; after that every
+/// rotary_encoder_task() call that changed something updates the segment.
+/// Other processes call rotary_encoder_shm_attach() and read the table or the
+/// event ring directly.  Linux only, needs ROTARY_ENCODER_PASS_HOOKS >= 1.
+///
+
+#ifndef ROTARY_ENCODERS_SHM_H_
+#define ROTARY_ENCODERS_SHM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "rotary_encoders.h"
+
+/// Layout version, bumped on any change to rotary_encoder_shm_t
+#define ROTARY_ENCODER_SHM_VERSION 2u
+
+/// Written last when the segment is ready, "RENC"
+#define ROTARY_ENCODER_SHM_MAGIC 0x52454E43u
+
+/// Number of events the ring holds, must be a power of two
+#define ROTARY_ENCODER_SHM_RING_SIZE 64u
+
+#if (0u != (ROTARY_ENCODER_SHM_RING_SIZE & (ROTARY_ENCODER_SHM_RING_SIZE - 1u)))
+#error "ROTARY_ENCODER_SHM_RING_SIZE must be a power of two"
+#endif
+
+/// Instance table entry, protected by its own sequence lock
+typedef struct rotary_encoder_shm_instance
+{
+    atomic_uint seq;                     /// Odd while being written
+    rotary_encoder_snapshot_t snapshot;  /// State after the last change
+
+} rotary_encoder_shm_instance_t;
+
+/// Event ring entry, one per changed instance per task call
+typedef struct rotary_encoder_shm_event
+{
+    atomic_uint event_num;               /// Event number + 1, 0 while written
+    uint8_t instance_num;                /// Instance that changed
+    rotary_encoder_snapshot_t snapshot;  /// State after the change
+
+} rotary_encoder_shm_event_t;
+
+/// Segment layout
+typedef struct rotary_encoder_shm
+{
+    atomic_uint magic;                   /// ROTARY_ENCODER_SHM_MAGIC once ready
+    uint16_t version;                    /// ROTARY_ENCODER_SHM_VERSION
+    uint16_t instance_count;             /// ROTARY_ENCODER_INSTANCES
+    uint32_t ring_size;                  /// ROTARY_ENCODER_SHM_RING_SIZE
+    uint32_t snapshot_size;              /// sizeof(rotary_encoder_snapshot_t)
+    atomic_uint event_count;             /// Number of events ever written
+
+    rotary_encoder_shm_instance_t instance[ROTARY_ENCODER_INSTANCES];
+    rotary_encoder_shm_event_t ring[ROTARY_ENCODER_SHM_RING_SIZE];
+
+} rotary_encoder_shm_t;
+
+// Task process side
+bool rotary_encoder_shm_open(char const * const p_name);
+void rotary_encoder_shm_close(void);
+
+// Consumer process side
+rotary_encoder_shm_t const * rotary_encoder_shm_attach(char const * const p_name);
+void rotary_encoder_shm_detach(rotary_encoder_shm_t const * const p_shm);
+
+bool rotary_encoder_shm_read_instance(rotary_encoder_shm_t const * const p_shm,
+                                      uint8_t const instance_num,
+                                      rotary_encoder_snapshot_t * const p_snapshot);
+
+bool rotary_encoder_shm_read_event(rotary_encoder_shm_t const * const p_shm,
+                                   uint32_t const event_num,
+                                   uint8_t * const p_instance_num,
+                                   rotary_encoder_snapshot_t * const p_snapshot);
+
+#endif /* ROTARY_ENCODERS_SHM_H_ */
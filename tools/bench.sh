@@ -0,0 +1,63 @@
+#!/bin/sh
+#
+# bench.sh
+#
+# Builds each host benchmark once per configuration and runs it, printing
+# one line per configuration.  Linux with pthreads, timings are wall clock
+# so run on an idle machine and compare lines from the same run.
+#
+# Usage: tools/bench.sh [filter]
+#     filter  Only run configurations whose name contains it
+# Change the compiler with CC and CFLAGS as for tools/size_report.sh.
+#
+
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:--O2}
+FILTER=${1:-}
+
+ROOT_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BIN=$(mktemp)
+trap 'rm -f "$BIN"' EXIT
+
+# Name, sources relative to the repository and compiler flags of each
+# configuration.  ROTARY_ENCODER_INSTANCES stops at 32, the flag words are
+# 32 bits, so 32 is the largest size measured.
+CONFIGS="
+frames_off_4|tools/bench_frames.c src/rotary_encoders.c|-DROTARY_ENCODER_INSTANCES=4 -DROTARY_ENCODER_MULTI_READER=1
+frames_on_4|tools/bench_frames.c src/rotary_encoders.c|-DROTARY_ENCODER_INSTANCES=4 -DROTARY_ENCODER_MULTI_READER=1 -DROTARY_ENCODER_FRAMES=3
+frames_off_32|tools/bench_frames.c src/rotary_encoders.c|-DROTARY_ENCODER_INSTANCES=32 -DROTARY_ENCODER_MULTI_READER=1
+frames_on_32|tools/bench_frames.c src/rotary_encoders.c|-DROTARY_ENCODER_INSTANCES=32 -DROTARY_ENCODER_MULTI_READER=1 -DROTARY_ENCODER_FRAMES=3
+server_4|tools/bench_server.c src/rotary_encoders.c src/rotary_encoders_server.c|-DROTARY_ENCODER_INSTANCES=4 -DROTARY_ENCODER_PASS_HOOKS=1
+server_32|tools/bench_server.c src/rotary_encoders.c src/rotary_encoders_server.c|-DROTARY_ENCODER_INSTANCES=32 -DROTARY_ENCODER_PASS_HOOKS=1
+padded_off_4|tools/bench_padded.c src/rotary_encoders.c|-DROTARY_ENCODER_INSTANCES=4 -DROTARY_ENCODER_BANKS=4 -DROTARY_ENCODER_MULTI_READER=1 -DROTARY_ENCODER_ATOMIC_FLAGS=1
+padded_on_4|tools/bench_padded.c src/rotary_encoders.c|-DROTARY_ENCODER_INSTANCES=4 -DROTARY_ENCODER_BANKS=4 -DROTARY_ENCODER_MULTI_READER=1 -DROTARY_ENCODER_ATOMIC_FLAGS=1 -DROTARY_ENCODER_PADDED_LAYOUT=1
+init_32|tools/bench_init.c src/rotary_encoders.c|-DROTARY_ENCODER_INSTANCES=32
+init_32_all|tools/bench_init.c src/rotary_encoders.c|-DROTARY_ENCODER_INSTANCES=32 -DROTARY_ENCODER_MULTI_READER=1 -DROTARY_ENCODER_DELTA_INPUT=1 -DROTARY_ENCODER_PARAMS=1
+wrap|tools/bench_wrap.c|-DROTARY_ENCODER_DELTA_INPUT=1
+"
+
+echo "$CONFIGS" | while IFS='|' read -r name sources flags
+do
+    [ -z "$name" ] && continue
+
+    case "$name" in
+        *"$FILTER"*) ;;
+        *) continue ;;
+    esac
+
+    srcs=""
+    for src in $sources
+    do
+        srcs="$srcs $ROOT_DIR/$src"
+    done
+
+    # shellcheck disable=SC2086
+    if ! $CC -std=c11 $CFLAGS $flags -I"$ROOT_DIR/src" $srcs -o "$BIN" -lpthread
+    then
+        echo "$name: build failed" >&2
+        continue
+    fi
+
+    printf '%-24s ' "$name"
+    "$BIN"
+done
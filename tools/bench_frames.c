@@ -0,0 +1,123 @@
+///
+/// bench_frames
+///
+/// Reader and writer cost of getting a coherent view of every instance while
+/// the task runs on another thread.  With ROTARY_ENCODER_FRAMES the reader
+/// copies the published frame, otherwise it reads each instance under its
+/// sequence lock.  Run through tools/bench.sh.
+///
+/// Prints:
+///   task_ns  Task call that changed every instance, alone on its thread
+///   read_ns  One coherent read of every instance, task running meanwhile
+///   task_ns_contended  Task call while the reader runs
+///
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "rotary_encoders.h"
+
+/// Run time of each measurement
+#define BENCH_NS 500000000ull
+
+static atomic_bool b_done;
+
+/// Keeps the reads from being optimized away
+static volatile int32_t bench_sink;
+
+static uint64_t bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+/// Turn every instance and run the task, as often as possible until done
+/// @return Number of task calls made
+static uint64_t bench_task(uint64_t const run_ns)
+{
+    uint64_t const start = bench_now();
+    uint64_t calls = 0;
+
+    while((bench_now() - start) < run_ns)
+    {
+        for(uint32_t n = 0; n < 64u; n++)
+        {
+            for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+            {
+                rotary_encoder_set_flags(i, ROTARY_ENCODER_FLAG_CW);
+            }
+
+            rotary_encoder_task();
+        }
+
+        calls += 64u;
+    }
+
+    return calls;
+}
+
+/// Read every instance coherently until the writer is done
+static void * bench_reader(void * p_arg)
+{
+    uint64_t * const p_reads = (uint64_t *)p_arg;
+    uint64_t reads = 0;
+    int32_t sum = 0;
+
+    while(!atomic_load_explicit(&b_done, memory_order_relaxed))
+    {
+#if ROTARY_ENCODER_FRAMES
+        rotary_encoder_frame_t frame;
+
+        rotary_encoder_copy_frame(&frame);
+        sum += frame.instance[0].knob_value;
+#else
+        for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+        {
+            rotary_encoder_snapshot_t snapshot;
+
+            rotary_encoder_get_snapshot(i, &snapshot);
+            sum += snapshot.knob_value;
+        }
+#endif
+        ++reads;
+    }
+
+    bench_sink = sum;
+    *p_reads = reads;
+
+    return 0;
+}
+
+int main(void)
+{
+    pthread_t reader;
+    uint64_t reads = 0;
+
+    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+    {
+        rotary_encoder_init(i, INT16_MIN, INT16_MAX, false, true);
+    }
+
+    uint64_t const calls_alone = bench_task(BENCH_NS);
+
+    atomic_store(&b_done, false);
+    pthread_create(&reader, 0, bench_reader, &reads);
+
+    uint64_t const calls = bench_task(BENCH_NS);
+
+    atomic_store(&b_done, true);
+    pthread_join(reader, 0);
+
+    printf("task_ns %7.1f  read_ns %7.1f  task_ns_contended %7.1f\n",
+           (double)BENCH_NS / (double)calls_alone,
+           (double)BENCH_NS / (double)((0u != reads) ? reads : 1u),
+           (double)BENCH_NS / (double)calls);
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+///
+/// bench_init
+///
+/// Boot time setup of every instance, from one const table with
+/// rotary_encoder_init_all() against one rotary_encoder_init() call per
+/// knob with the same values.  Run through tools/bench.sh.  For the code
+/// each caller takes, build the same way and list the two functions with
+/// nm -S --size-sort.
+///
+/// Prints:
+///   table_ns  rotary_encoder_init_all() of every instance
+///   calls_ns  One rotary_encoder_init() per instance
+///
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <time.h>
+
+#include "rotary_encoders.h"
+
+/// Setups timed for each figure
+#define BENCH_RUNS 100000u
+
+/// Bounds and options of knob n, different for each so nothing folds
+#define BENCH_MIN(n)  ((int16_t)(-10 * (n)))
+#define BENCH_MAX(n)  ((int16_t)((10 * (n)) + 5))
+#define BENCH_STEP(n) (0u != ((n) & 1u))
+
+/// Expand a macro once per instance, as a board with 32 knobs would
+#define BENCH_EACH(X) \
+        X(0)  X(1)  X(2)  X(3)  X(4)  X(5)  X(6)  X(7)  \
+        X(8)  X(9)  X(10) X(11) X(12) X(13) X(14) X(15) \
+        X(16) X(17) X(18) X(19) X(20) X(21) X(22) X(23) \
+        X(24) X(25) X(26) X(27) X(28) X(29) X(30) X(31)
+
+#if ROTARY_ENCODER_INSTANCES != 32u
+#error "bench_init expects ROTARY_ENCODER_INSTANCES of 32"
+#endif
+
+#define BENCH_ENTRY(n) {BENCH_MIN(n), BENCH_MAX(n), BENCH_STEP(n), true, 0u},
+#define BENCH_CALL(n)  b_status &= rotary_encoder_init((n), BENCH_MIN(n), BENCH_MAX(n), \
+                                                       BENCH_STEP(n), true);
+
+static rotary_encoder_config_t const bench_table[ROTARY_ENCODER_INSTANCES] =
+{
+    BENCH_EACH(BENCH_ENTRY)
+};
+
+static uint64_t bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+/// Set up every instance from the table
+__attribute__((noinline)) static bool bench_init_table(void)
+{
+    return rotary_encoder_init_all(bench_table, ROTARY_ENCODER_INSTANCES);
+}
+
+/// Set up every instance with its own call
+__attribute__((noinline)) static bool bench_init_calls(void)
+{
+    bool b_status = true;
+
+    BENCH_EACH(BENCH_CALL)
+
+    return b_status;
+}
+
+/// Time one way of setting up every instance
+/// @return Average time of one setup in ns
+static double bench_run(bool (*p_init)(void))
+{
+    bool b_status = true;
+    uint64_t const start = bench_now();
+
+    for(uint32_t n = 0; n < BENCH_RUNS; n++)
+    {
+        b_status &= p_init();
+    }
+
+    uint64_t const elapsed = bench_now() - start;
+
+    if(!b_status)
+    {
+        fprintf(stderr, "bench_init: setup failed\n");
+    }
+
+    return (double)elapsed / (double)BENCH_RUNS;
+}
+
+int main(void)
+{
+    // Warm up, then alternate so neither side gets a quieter machine
+    bench_run(bench_init_table);
+    bench_run(bench_init_calls);
+
+    double const table_ns = bench_run(bench_init_table);
+    double const calls_ns = bench_run(bench_init_calls);
+
+    printf("table_ns %7.1f  calls_ns %7.1f\n", table_ns, calls_ns);
+
+    return 0;
+}
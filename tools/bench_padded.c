@@ -0,0 +1,115 @@
+///
+/// bench_padded
+///
+/// False sharing between banks.  One thread per bank turns its own instance
+/// and runs rotary_encoder_task_bank() for it, so no two threads ever write
+/// the same data.  Without ROTARY_ENCODER_PADDED_LAYOUT neighbouring
+/// instances still share cache lines, which the threads then fight over.
+/// Run through tools/bench.sh, the gap only shows with a core per thread.
+///
+/// Prints:
+///   alone_ns   Turn plus bank task call, one thread running
+///   shared_ns  Same, averaged over all threads running at once
+///
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "rotary_encoders.h"
+
+/// Run time of each measurement
+#define BENCH_NS 500000000ull
+
+static atomic_bool b_go;
+static atomic_bool b_done;
+static uint64_t calls_arr[ROTARY_ENCODER_BANKS];
+
+static uint64_t bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+/// Turn the instance of one bank and run its task until done
+static void * bench_bank(void * p_arg)
+{
+    uint8_t const bank_num = (uint8_t)(uintptr_t)p_arg;
+    uint64_t calls = 0;
+
+    while(!atomic_load_explicit(&b_go, memory_order_relaxed))
+    {
+    }
+
+    while(!atomic_load_explicit(&b_done, memory_order_relaxed))
+    {
+        for(uint32_t n = 0; n < 64u; n++)
+        {
+            rotary_encoder_set_flags(bank_num, ROTARY_ENCODER_FLAG_CW);
+            rotary_encoder_task_bank(bank_num);
+        }
+
+        calls += 64u;
+    }
+
+    calls_arr[bank_num] = calls;
+
+    return 0;
+}
+
+/// Run the first thread_count bank threads for BENCH_NS
+/// @return Average time per call of one thread, in ns
+static double bench_run(uint8_t const thread_count)
+{
+    pthread_t thread_arr[ROTARY_ENCODER_BANKS];
+    uint64_t calls = 0;
+
+    atomic_store(&b_go, false);
+    atomic_store(&b_done, false);
+
+    for(uint8_t b = 0; b < thread_count; b++)
+    {
+        pthread_create(&thread_arr[b], 0, bench_bank, (void *)(uintptr_t)b);
+    }
+
+    uint64_t const start = bench_now();
+
+    atomic_store(&b_go, true);
+
+    while((bench_now() - start) < BENCH_NS)
+    {
+        nanosleep(&(struct timespec){0, 1000000}, 0);
+    }
+
+    atomic_store(&b_done, true);
+
+    for(uint8_t b = 0; b < thread_count; b++)
+    {
+        pthread_join(thread_arr[b], 0);
+        calls += calls_arr[b];
+    }
+
+    // Each thread ran the whole time, so average the time of one call
+    return ((double)BENCH_NS * (double)thread_count) / (double)((0u != calls) ? calls : 1u);
+}
+
+int main(void)
+{
+    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+    {
+        rotary_encoder_init(i, INT16_MIN, INT16_MAX, false, true);
+        rotary_encoder_set_bank(i, (uint8_t)(i % ROTARY_ENCODER_BANKS));
+    }
+
+    double const alone_ns = bench_run(1);
+    double const shared_ns = bench_run(ROTARY_ENCODER_BANKS);
+
+    printf("alone_ns %7.1f  shared_ns %7.1f\n", alone_ns, shared_ns);
+
+    return 0;
+}
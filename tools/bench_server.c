@@ -0,0 +1,160 @@
+///
+/// bench_server
+///
+/// Throughput and latency of rotary_encoders_server against a local client
+/// thread.  Run through tools/bench.sh.
+///
+/// Prints:
+///   lat_p50_us, lat_p99_us  One instance turned, from the flag to the client
+///                           returning from recv(), task and client on
+///                           their own threads
+///   frames_s                Frames the client received per second with
+///                           every instance changing on every task call
+///   dropped                 Frames the server dropped for the slow client
+///
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rotary_encoders_server.h"
+
+/// Turns timed for the latency figures
+#define BENCH_TURNS 20000u
+
+/// Run time of the throughput measurement
+#define BENCH_NS 500000000ull
+
+static atomic_ullong send_time;
+static atomic_uint received;
+static atomic_bool b_done;
+static uint32_t latency_arr[BENCH_TURNS];
+
+static uint64_t bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_compare(void const * p_a, void const * p_b)
+{
+    uint32_t const a = *(uint32_t const *)p_a;
+    uint32_t const b = *(uint32_t const *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/// Client, times each frame against the send time, then counts frames
+static void * bench_client(void * p_arg)
+{
+    int const fd = *(int *)p_arg;
+    uint8_t frame[ROTARY_ENCODER_SERVER_FRAME_MAX];
+    unsigned n = 0;
+
+    while(!atomic_load(&b_done))
+    {
+        if(0 < recv(fd, frame, sizeof(frame), 0))
+        {
+            if(n < BENCH_TURNS)
+            {
+                latency_arr[n] = (uint32_t)(bench_now() - atomic_load(&send_time));
+            }
+
+            ++n;
+            atomic_store(&received, n);
+        }
+    }
+
+    return 0;
+}
+
+int main(void)
+{
+    char const * const p_path = "/tmp/bench_server.sock";
+    struct sockaddr_un addr = {0};
+    struct timeval timeout = {0, 100000};
+    pthread_t client;
+
+    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+    {
+        rotary_encoder_init(i, INT16_MIN, INT16_MAX, false, true);
+    }
+
+    int const fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, p_path);
+
+    if(!rotary_encoder_server_open(p_path) ||
+       (0 != connect(fd, (struct sockaddr *)&addr, sizeof(addr))))
+    {
+        fprintf(stderr, "bench_server: can not open %s\n", p_path);
+        return 1;
+    }
+
+    // Lets the client thread see b_done while no frames come
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    rotary_encoder_server_poll(100);
+
+    pthread_create(&client, 0, bench_client, (void *)&fd);
+
+    // Latency, one turn at a time, waiting for the client each time
+    for(unsigned n = 0; n < BENCH_TURNS; n++)
+    {
+        atomic_store(&send_time, bench_now());
+        rotary_encoder_set_flags(0, ROTARY_ENCODER_FLAG_CW);
+        rotary_encoder_task();
+
+        while(atomic_load(&received) <= n)
+        {
+            sched_yield();
+        }
+    }
+
+    // Throughput, every instance changes on every call, as fast as possible
+    unsigned const received_start = atomic_load(&received);
+    uint64_t const start = bench_now();
+
+    while((bench_now() - start) < BENCH_NS)
+    {
+        for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+        {
+            rotary_encoder_set_flags(i, ROTARY_ENCODER_FLAG_CW);
+        }
+
+        rotary_encoder_task();
+    }
+
+    // Frames still queued in the socket count as received
+    nanosleep(&(struct timespec){0, 200000000}, 0);
+
+    unsigned const frames = atomic_load(&received) - received_start;
+
+    atomic_store(&b_done, true);
+    pthread_join(client, 0);
+
+    close(fd);
+    rotary_encoder_server_close();
+
+    qsort(latency_arr, BENCH_TURNS, sizeof(latency_arr[0]), bench_compare);
+
+    printf("lat_p50_us %6.1f  lat_p99_us %6.1f  frames_s %9.0f  dropped %u\n",
+           latency_arr[BENCH_TURNS / 2u] / 1000.0,
+           latency_arr[(BENCH_TURNS * 99u) / 100u] / 1000.0,
+           (double)frames * 1e9 / (double)BENCH_NS,
+           rotary_encoder_server_get_dropped_count());
+
+    return 0;
+}
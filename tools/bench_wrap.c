@@ -0,0 +1,127 @@
+///
+/// bench_wrap
+///
+/// Rollover of large deltas across range sizes.  rotary_encoder_wrap() uses a
+/// mask for power of two ranges and a reciprocal otherwise, the baseline is
+/// the plain % it replaced.  Builds the module into this file to reach the
+/// static function, so its bench.sh line lists no other sources.
+/// Run through tools/bench.sh.
+///
+/// Prints, per range, range: wrap_ns/mod_ns
+///   wrap_ns  One rotary_encoder_wrap()
+///   mod_ns   One wrap with %
+///
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <time.h>
+
+#include "rotary_encoders.c"
+
+#if !ROTARY_ENCODER_DELTA_INPUT
+#error "bench_wrap needs ROTARY_ENCODER_DELTA_INPUT"
+#endif
+
+/// Offsets folded per timed pass, a power of two
+#define BENCH_OFFSETS 4096u
+
+/// Passes over the offsets for each figure
+#define BENCH_PASSES 2000u
+
+static int32_t bench_offset_arr[BENCH_OFFSETS];
+
+/// Keeps the results from being optimized away
+static volatile int32_t bench_sink;
+
+static uint64_t bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+/// Wrap with a divide, as the module did before
+/// A call like rotary_encoder_wrap() at -Os, so the calls cost both the same
+__attribute__((noinline)) static int32_t bench_mod(int32_t const range,
+                                                   int32_t const offset)
+{
+    int32_t const rem = offset % range;
+
+    return (0 > rem) ? (rem + range) : rem;
+}
+
+/// Time both ways of wrapping for one range and check they agree
+/// Not inlined, so neither way sees the range as a constant
+/// @param range Knob range, max - min + 1
+__attribute__((noinline)) static void bench_range(int32_t const range)
+{
+    rotary_encoder_t const * const p_inst = &instance_arr[0];
+    int32_t sum = 0;
+
+    rotary_encoder_init(0, INT16_MIN, (int16_t)(INT16_MIN + range - 1), false, true);
+
+    for(uint32_t n = 0; n < BENCH_OFFSETS; n++)
+    {
+        if(rotary_encoder_wrap(p_inst, bench_offset_arr[n]) !=
+           bench_mod(range, bench_offset_arr[n]))
+        {
+            fprintf(stderr, "bench_wrap: range %ld offset %ld differs\n",
+                    (long)range, (long)bench_offset_arr[n]);
+        }
+    }
+
+    uint64_t const wrap_start = bench_now();
+
+    for(uint32_t p = 0; p < BENCH_PASSES; p++)
+    {
+        for(uint32_t n = 0; n < BENCH_OFFSETS; n++)
+        {
+            sum += rotary_encoder_wrap(p_inst, bench_offset_arr[n]);
+        }
+    }
+
+    uint64_t const mod_start = bench_now();
+
+    for(uint32_t p = 0; p < BENCH_PASSES; p++)
+    {
+        for(uint32_t n = 0; n < BENCH_OFFSETS; n++)
+        {
+            sum += bench_mod(range, bench_offset_arr[n]);
+        }
+    }
+
+    uint64_t const end = bench_now();
+    double const count = (double)BENCH_PASSES * (double)BENCH_OFFSETS;
+
+    bench_sink = sum;
+
+    printf(" %ld: %.2f/%.2f", (long)range,
+           (double)(mod_start - wrap_start) / count,
+           (double)(end - mod_start) / count);
+}
+
+int main(void)
+{
+    static int32_t const range_arr[] = {2, 10, 64, 100, 1000, 65536};
+    uint32_t seed = 1u;
+
+    // Deltas up to half a million steps either way, any range rolls over
+    for(uint32_t n = 0; n < BENCH_OFFSETS; n++)
+    {
+        seed = (seed * 1664525u) + 1013904223u;
+        bench_offset_arr[n] = (int32_t)(seed >> 12) - (1 << 19);
+    }
+
+    printf("wrap_ns/mod_ns");
+
+    for(uint32_t r = 0; r < (sizeof(range_arr) / sizeof(range_arr[0])); r++)
+    {
+        bench_range(range_arr[r]);
+    }
+
+    printf("\n");
+
+    return 0;
+}
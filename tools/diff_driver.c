@@ -0,0 +1,403 @@
+///
+/// diff_driver
+///
+/// Differential test of the module against a reference model kept here.
+/// Replays a long seeded random sequence of public API calls: flags, deltas,
+/// set, inc, dec and toggle, inits with random bounds, task calls and alert
+/// reads.  After every call it compares the knob value, switch, event and
+/// alert flags, and with ROTARY_ENCODER_ALERT_BITS the alert bits and counts,
+/// and stops at the first difference with the seed and step to replay.
+///
+/// The model works the bounds out with plain 64 bit arithmetic and %, not
+/// the way the module does, so the two only agree if the module is right.
+/// ROTARY_ENCODER_SELF_CHECK can be set as well to also check every move
+/// inside the module.
+///
+/// Build and run on the host, for example
+///     cc -std=c11 -O2 -DROTARY_ENCODER_DELTA_INPUT=1
+///        -DROTARY_ENCODER_ALERT_BITS=1 -Isrc
+///        tools/diff_driver.c src/rotary_encoders.c -o diff_driver
+///     ./diff_driver [seed] [steps]
+///
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rotary_encoders.h"
+
+#if ROTARY_ENCODER_NOTIFY_THRESHOLD || ROTARY_ENCODER_INERTIA || \
+    ROTARY_ENCODER_REVERSAL_FILTER || ROTARY_ENCODER_GLITCH_FILTER || \
+    ROTARY_ENCODER_STORM_GUARD
+#error "diff_driver models plain knobs, build it without filters or inertia"
+#endif
+
+/// Largest delta total the module keeps between task calls
+#define DIFF_DELTA_LIMIT 0x3FFFFFFF
+
+/// Default number of calls replayed
+#define DIFF_STEPS 1000000ul
+
+/// Reference state of one instance
+typedef struct diff_model
+{
+    int32_t value;
+    int32_t min_value;
+    int32_t max_value;
+    bool b_step_on;
+    bool b_cw_pos;
+    bool b_switch;
+    bool b_event;
+    bool b_alert;
+    uint8_t alert_bits;
+    uint16_t alert_count;
+
+    // Flags and deltas fed, not yet handled by a task call
+    bool b_flag_cw;
+    bool b_flag_ccw;
+    bool b_flag_sw;
+    bool b_flag_delta;
+    int32_t delta;
+
+} diff_model_t;
+
+static diff_model_t model_arr[ROTARY_ENCODER_INSTANCES];
+static uint32_t diff_seed;
+static uint32_t diff_start_seed;
+static unsigned long diff_step;
+
+/// Next pseudo random number, xorshift32
+static uint32_t diff_rand(void)
+{
+    diff_seed ^= diff_seed << 13;
+    diff_seed ^= diff_seed >> 17;
+    diff_seed ^= diff_seed << 5;
+
+    return diff_seed;
+}
+
+/// Random number from 0 to n - 1
+static uint32_t diff_below(uint32_t const n)
+{
+    return diff_rand() % n;
+}
+
+/// Random int16_t, mostly small, sometimes anywhere in the range
+static int16_t diff_int16(void)
+{
+    return (0u == diff_below(4u)) ? (int16_t)(diff_rand() & 0xFFFFu) :
+                                    (int16_t)((int32_t)diff_below(41u) - 20);
+}
+
+/// Record that a model instance hit a bound
+static void diff_alert(diff_model_t * const p_model, bool const b_max)
+{
+    p_model->b_alert = true;
+    p_model->alert_bits |= p_model->b_step_on ?
+                           (b_max ? ROTARY_ENCODER_ALERT_CLAMP_MAX : ROTARY_ENCODER_ALERT_CLAMP_MIN) :
+                           (b_max ? ROTARY_ENCODER_ALERT_WRAP_MAX : ROTARY_ENCODER_ALERT_WRAP_MIN);
+
+    if(UINT16_MAX != p_model->alert_count)
+    {
+        ++p_model->alert_count;
+    }
+}
+
+/// Move a model instance by delta steps: clamp, or roll over as often as it
+/// passed a bound, with one alert if it left the bounds
+static void diff_move(diff_model_t * const p_model, int64_t const delta)
+{
+    int64_t const range = (int64_t)p_model->max_value - p_model->min_value + 1;
+    int64_t value = p_model->value + delta;
+
+    if((value > p_model->max_value) || (value < p_model->min_value))
+    {
+        bool const b_max = (0 < delta);
+
+        if(p_model->b_step_on)
+        {
+            value = b_max ? p_model->max_value : p_model->min_value;
+        }
+        else
+        {
+            int64_t const rem = (value - p_model->min_value) % range;
+
+            value = p_model->min_value + ((0 > rem) ? (rem + range) : rem);
+        }
+
+        diff_alert(p_model, b_max);
+    }
+
+    p_model->value = (int32_t)value;
+}
+
+/// Set a model instance to a value, as rotary_encoder_set_knob_value()
+/// Out of bounds goes to the bound, or the other bound when rolling over
+static void diff_set(diff_model_t * const p_model, int32_t const value)
+{
+    bool const b_max = (value > p_model->max_value);
+
+    p_model->value = value;
+
+    if(b_max || (value < p_model->min_value))
+    {
+        p_model->value = (b_max == p_model->b_step_on) ? p_model->max_value :
+                                                         p_model->min_value;
+        diff_alert(p_model, b_max);
+    }
+}
+
+/// Handle the flags and deltas of every model instance, as the task
+static void diff_task(void)
+{
+    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+    {
+        diff_model_t * const p_model = &model_arr[i];
+        bool b_changed = false;
+
+        if(p_model->b_flag_cw)
+        {
+            diff_move(p_model, (p_model->b_cw_pos ? 1 : -1));
+            b_changed = true;
+        }
+
+        if(p_model->b_flag_ccw)
+        {
+            diff_move(p_model, (p_model->b_cw_pos ? -1 : 1));
+            b_changed = true;
+        }
+
+        if(p_model->b_flag_delta && (0 != p_model->delta))
+        {
+            diff_move(p_model, p_model->delta);
+            b_changed = true;
+        }
+
+        if(p_model->b_flag_sw)
+        {
+            p_model->b_switch = !p_model->b_switch;
+            b_changed = true;
+        }
+
+        p_model->b_event |= b_changed;
+        p_model->b_flag_cw = false;
+        p_model->b_flag_ccw = false;
+        p_model->b_flag_sw = false;
+        p_model->b_flag_delta = false;
+        p_model->delta = 0;
+    }
+}
+
+/// Stop with the seed and step to replay
+static void diff_fail(char const * const p_what, uint8_t const instance_num,
+                      long const expected, long const actual)
+{
+    printf("diff_driver: seed %lu step %lu instance %u %s expected %ld got %ld\n",
+           (unsigned long)diff_start_seed, diff_step, instance_num, p_what,
+           expected, actual);
+    exit(1);
+}
+
+/// Compare what readers see of every instance against the model
+static void diff_compare(void)
+{
+    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+    {
+        diff_model_t const * const p_model = &model_arr[i];
+        rotary_encoder_snapshot_t snapshot;
+
+        rotary_encoder_get_snapshot(i, &snapshot);
+
+        if(snapshot.knob_value != p_model->value)
+        {
+            diff_fail("value", i, p_model->value, snapshot.knob_value);
+        }
+
+        if(snapshot.b_switch_value != p_model->b_switch)
+        {
+            diff_fail("switch", i, p_model->b_switch, snapshot.b_switch_value);
+        }
+
+        if(snapshot.b_event_occured != p_model->b_event)
+        {
+            diff_fail("event", i, p_model->b_event, snapshot.b_event_occured);
+        }
+
+        if(snapshot.b_alert_occured != p_model->b_alert)
+        {
+            diff_fail("alert", i, p_model->b_alert, snapshot.b_alert_occured);
+        }
+    }
+}
+
+/// Init an instance with random bounds, in the module and the model
+static void diff_init(uint8_t const instance_num)
+{
+    diff_model_t * const p_model = &model_arr[instance_num];
+    int16_t a = diff_int16();
+    int16_t b = diff_int16();
+
+    // Small ranges now and then, where rolling over happens all the time
+    if(0u == diff_below(4u))
+    {
+        b = (int16_t)(a + (int16_t)diff_below(4u));
+        b = (b < a) ? a : b;
+    }
+
+    int16_t const min_value = (a < b) ? a : b;
+    int16_t const max_value = (a < b) ? b : a;
+    bool const b_step_on = (0u == diff_below(2u));
+    bool const b_cw_pos = (0u == diff_below(2u));
+
+    rotary_encoder_init(instance_num, min_value, max_value, b_step_on, b_cw_pos);
+
+    p_model->min_value = min_value;
+    p_model->max_value = max_value;
+    p_model->value = (0 < min_value) ? min_value : (0 > max_value) ? max_value : 0;
+    p_model->b_step_on = b_step_on;
+    p_model->b_cw_pos = b_cw_pos;
+    p_model->b_switch = false;
+    p_model->b_event = false;
+    p_model->b_alert = false;
+    p_model->alert_bits = 0;
+    p_model->alert_count = 0;
+}
+
+/// Make one random call against the module and the model
+static void diff_call(void)
+{
+    uint8_t const i = (uint8_t)diff_below(ROTARY_ENCODER_INSTANCES);
+    diff_model_t * const p_model = &model_arr[i];
+    uint32_t const op = diff_below(16u);
+
+    if(3u > op)
+    {
+        uint8_t const flag_arr[3] = {ROTARY_ENCODER_FLAG_CW, ROTARY_ENCODER_FLAG_CCW,
+                                     ROTARY_ENCODER_FLAG_SW};
+
+        rotary_encoder_set_flags(i, flag_arr[op]);
+        p_model->b_flag_cw |= (0u == op);
+        p_model->b_flag_ccw |= (1u == op);
+        p_model->b_flag_sw |= (2u == op);
+    }
+#if ROTARY_ENCODER_DELTA_INPUT
+    else if(6u > op)
+    {
+        int16_t const delta = diff_int16();
+        int32_t const sum = p_model->delta + delta;
+
+        rotary_encoder_feed_delta(i, delta, 0u);
+        p_model->b_flag_delta = true;
+        p_model->delta = (sum > DIFF_DELTA_LIMIT) ? DIFF_DELTA_LIMIT :
+                         (sum < -DIFF_DELTA_LIMIT) ? -DIFF_DELTA_LIMIT : sum;
+    }
+#endif
+    else if(6u == op)
+    {
+        int16_t const value = diff_int16();
+
+        rotary_encoder_set_knob_value(i, value);
+        diff_set(p_model, value);
+    }
+    else if(7u == op)
+    {
+        rotary_encoder_inc_knob_value(i);
+        diff_set(p_model, p_model->value + 1);
+    }
+    else if(8u == op)
+    {
+        rotary_encoder_dec_knob_value(i);
+        diff_set(p_model, p_model->value - 1);
+    }
+    else if(9u == op)
+    {
+        rotary_encoder_tog_switch_value(i);
+        p_model->b_switch = !p_model->b_switch;
+    }
+    else if(10u == op)
+    {
+        if(rotary_encoder_check_event(i) != p_model->b_event)
+        {
+            diff_fail("check_event", i, p_model->b_event, !p_model->b_event);
+        }
+
+        p_model->b_event = false;
+    }
+    else if(11u == op)
+    {
+        bool const b_alert = rotary_encoder_check_alert(i);
+
+        if(b_alert != p_model->b_alert)
+        {
+            diff_fail("check_alert", i, p_model->b_alert, b_alert);
+        }
+
+        p_model->b_alert = false;
+    }
+#if ROTARY_ENCODER_ALERT_BITS
+    else if(12u == op)
+    {
+        uint8_t bits_arr[ROTARY_ENCODER_INSTANCES];
+        uint16_t count_arr[ROTARY_ENCODER_INSTANCES];
+
+        rotary_encoder_take_alerts(bits_arr, count_arr);
+
+        for(uint8_t n = 0; n < ROTARY_ENCODER_INSTANCES; n++)
+        {
+            if(bits_arr[n] != model_arr[n].alert_bits)
+            {
+                diff_fail("alert bits", n, model_arr[n].alert_bits, bits_arr[n]);
+            }
+
+            if(count_arr[n] != model_arr[n].alert_count)
+            {
+                diff_fail("alert count", n, model_arr[n].alert_count, count_arr[n]);
+            }
+
+            model_arr[n].alert_bits = 0;
+            model_arr[n].alert_count = 0;
+            model_arr[n].b_alert = false;
+        }
+    }
+#endif
+    else if(13u == op)
+    {
+        // Flags still pending carry over to the new bounds, so only init
+        // right after the task handled everything
+        rotary_encoder_task();
+        diff_task();
+
+        if(0u == diff_below(8u))
+        {
+            diff_init(i);
+        }
+    }
+    else
+    {
+        rotary_encoder_task();
+        diff_task();
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    uint32_t const seed = (1 < argc) ? (uint32_t)strtoul(argv[1], 0, 0) : 1u;
+    unsigned long const steps = (2 < argc) ? strtoul(argv[2], 0, 0) : DIFF_STEPS;
+
+    diff_start_seed = seed;
+    diff_seed = (0u != seed) ? seed : 1u;
+
+    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+    {
+        diff_init(i);
+    }
+
+    for(diff_step = 0; diff_step < steps; diff_step++)
+    {
+        diff_call();
+        diff_compare();
+    }
+
+    printf("diff_driver: seed %lu, %lu steps, no differences\n",
+           (unsigned long)seed, steps);
+
+    return 0;
+}
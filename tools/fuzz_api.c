@@ -0,0 +1,338 @@
+///
+/// fuzz_api
+///
+/// Fuzz target for the public API.  Decodes the input into calls with any
+/// instance number, bounds, flags, deltas and bank, plus task calls, and
+/// after every call checks rotary_encoder_check_invariants() and the CPU
+/// time the call took against a budget, so slow paths fail like crashes do.
+/// Builds the module into this file so the clock the module reads is the
+/// one the input moves, which keeps every input replaying the same way.
+/// Set FUZZ_CALL_BUDGET to change the budget, in ns.
+///
+/// Build and run with libFuzzer, add -D options for more features:
+///     clang -g -O1 -fsanitize=fuzzer,address,undefined -Isrc
+///           -DROTARY_ENCODER_DELTA_INPUT=1 -DROTARY_ENCODER_ALERT_BITS=1
+///           -DROTARY_ENCODER_PARAMS=1 -DROTARY_ENCODER_TASK_BUDGET=1
+///           tools/fuzz_api.c -o fuzz_api
+///     ./fuzz_api corpus_dir
+///
+/// Without libFuzzer, add -DFUZZ_MAIN for a main that replays each file
+/// given, or random inputs when none is given:
+///     cc -std=c11 -g -fsanitize=address,undefined -DFUZZ_MAIN -Isrc
+///        tools/fuzz_api.c -o fuzz_api
+///
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/// Clock the module reads, only the input moves it
+static uint32_t fuzz_clock;
+
+#define ROTARY_ENCODER_SELF_CHECK 1u
+#define ROTARY_ENCODER_TIMESTAMP() (fuzz_clock)
+
+#include "rotary_encoders.c"
+
+/// CPU time one call may take, in ns, loose enough for sanitizer builds
+#ifndef FUZZ_CALL_BUDGET
+#define FUZZ_CALL_BUDGET 20000000u
+#endif
+
+/// Instance numbers tried go this far past the last instance
+#define FUZZ_INSTANCES (ROTARY_ENCODER_INSTANCES + 2u)
+
+#if ROTARY_ENCODER_PARAMS
+static rotary_encoder_param_t fuzz_param_arr[2];
+#endif
+
+/// Input still to decode
+static uint8_t const * p_fuzz_data;
+static size_t fuzz_size;
+
+/// Next input byte, 0 once the input is used up
+static uint8_t fuzz_byte(void)
+{
+    uint8_t byte = 0u;
+
+    if(0u != fuzz_size)
+    {
+        byte = *p_fuzz_data;
+        ++p_fuzz_data;
+        --fuzz_size;
+    }
+
+    return byte;
+}
+
+/// Next two input bytes as a value
+static int16_t fuzz_int16(void)
+{
+    uint16_t const low = fuzz_byte();
+
+    return (int16_t)(low | ((uint16_t)fuzz_byte() << 8));
+}
+
+/// CPU time of this thread, so other programs running do not count
+static uint64_t fuzz_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+#if ROTARY_ENCODER_STORM_GUARD
+static void fuzz_set_irq_enabled(uint8_t const instance_num, bool const b_enable)
+{
+    (void)instance_num;
+    (void)b_enable;
+}
+
+static uint8_t fuzz_sample(uint8_t const instance_num)
+{
+    (void)instance_num;
+
+    return fuzz_byte() & (ROTARY_ENCODER_FLAG_CW | ROTARY_ENCODER_FLAG_CCW);
+}
+#endif
+
+/// Put every instance back to the same state, so each input replays alone
+static void fuzz_reset(void)
+{
+    rotary_encoder_config_t cfg_arr[ROTARY_ENCODER_INSTANCES];
+
+    for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+    {
+        cfg_arr[i] = (rotary_encoder_config_t){-100, 100, false, true, 0u};
+#if ROTARY_ENCODER_PARAMS
+        rotary_encoder_bind_param(i, 0, false);
+#endif
+    }
+
+    rotary_encoder_task();
+    rotary_encoder_init_all(cfg_arr, ROTARY_ENCODER_INSTANCES);
+
+#if ROTARY_ENCODER_STORM_GUARD
+    static rotary_encoder_storm_hooks_t const hooks =
+    {
+        fuzz_set_irq_enabled,
+        fuzz_sample
+    };
+
+    rotary_encoder_set_storm_hooks(&hooks);
+#endif
+}
+
+/// Make one call decoded from the input
+/// @param op           Call to make
+/// @param instance_num Instance number to pass, can be out of range
+static void fuzz_call(uint8_t const op, uint8_t const instance_num)
+{
+
+    if(0u == op)
+    {
+        int16_t const min_value = fuzz_int16();
+        int16_t const max_value = fuzz_int16();
+        uint8_t const options = fuzz_byte();
+
+        rotary_encoder_init(instance_num, min_value, max_value,
+                            (0u != (options & 1u)), (0u != (options & 2u)));
+    }
+    else if(1u == op)
+    {
+        rotary_encoder_config_t cfg_arr[ROTARY_ENCODER_INSTANCES];
+        uint8_t const count = fuzz_byte() % (ROTARY_ENCODER_INSTANCES + 2u);
+
+        for(uint8_t i = 0; i < ROTARY_ENCODER_INSTANCES; i++)
+        {
+            uint8_t const options = fuzz_byte();
+
+            cfg_arr[i].min_value = fuzz_int16();
+            cfg_arr[i].max_value = fuzz_int16();
+            cfg_arr[i].b_step_on = (0u != (options & 1u));
+            cfg_arr[i].b_cw_rot_pos = (0u != (options & 2u));
+            cfg_arr[i].bank_num = (uint8_t)((options >> 2) % (ROTARY_ENCODER_BANKS + 1u));
+        }
+
+        // A count past the table must fail without reading past it
+        rotary_encoder_init_all(cfg_arr, count);
+    }
+    else if(5u > op)
+    {
+        rotary_encoder_set_flags(instance_num, fuzz_byte());
+    }
+#if ROTARY_ENCODER_DELTA_INPUT
+    else if(5u == op)
+    {
+        rotary_encoder_feed_delta(instance_num, fuzz_int16(), fuzz_clock);
+    }
+#endif
+    else if(6u == op)
+    {
+        rotary_encoder_set_knob_value(instance_num, fuzz_int16());
+    }
+    else if(7u == op)
+    {
+        rotary_encoder_inc_knob_value(instance_num);
+        rotary_encoder_dec_knob_value((uint8_t)(fuzz_byte() % FUZZ_INSTANCES));
+    }
+    else if(8u == op)
+    {
+        rotary_encoder_tog_switch_value(instance_num);
+    }
+    else if(9u == op)
+    {
+        rotary_encoder_set_bank(instance_num,
+                                (uint8_t)(fuzz_byte() % (ROTARY_ENCODER_BANKS + 1u)));
+    }
+#if ROTARY_ENCODER_PARAMS
+    else if(10u == op)
+    {
+        uint8_t const options = fuzz_byte();
+        rotary_encoder_param_t * const p_param = &fuzz_param_arr[options & 1u];
+
+        // New bounds for the parameter, as when a page is set up again
+        if(0u != (options & 2u))
+        {
+            int16_t const a = fuzz_int16();
+            int16_t const b = fuzz_int16();
+
+            p_param->min_value = (a < b) ? a : b;
+            p_param->max_value = (a < b) ? b : a;
+            p_param->value = p_param->min_value;
+            p_param->b_step_on = (0u != (options & 4u));
+        }
+
+        rotary_encoder_bind_param(instance_num, (0u != (options & 8u)) ? p_param : 0,
+                                  (0u != (options & 16u)));
+    }
+#endif
+    else if(11u == op)
+    {
+        rotary_encoder_snapshot_t snapshot;
+
+        rotary_encoder_get_knob_value(instance_num);
+        rotary_encoder_get_switch_value(instance_num);
+        rotary_encoder_get_snapshot(instance_num, &snapshot);
+        rotary_encoder_get_bank(instance_num);
+        rotary_encoder_check_event(instance_num);
+        rotary_encoder_check_alert(instance_num);
+    }
+#if ROTARY_ENCODER_ALERT_BITS
+    else if(12u == op)
+    {
+        uint8_t bits_arr[ROTARY_ENCODER_INSTANCES];
+        uint16_t count_arr[ROTARY_ENCODER_INSTANCES];
+
+        rotary_encoder_take_alerts(bits_arr, count_arr);
+    }
+#endif
+#if ROTARY_ENCODER_TASK_BUDGET
+    else if(13u == op)
+    {
+        rotary_encoder_task_budget(fuzz_byte());
+    }
+#endif
+    else if(14u == op)
+    {
+        rotary_encoder_task_bank((uint8_t)(fuzz_byte() % (ROTARY_ENCODER_BANKS + 1u)));
+    }
+    else
+    {
+        fuzz_clock += fuzz_byte();
+#if ROTARY_ENCODER_STORM_GUARD
+        rotary_encoder_storm_poll();
+#endif
+        rotary_encoder_task();
+    }
+}
+
+int LLVMFuzzerTestOneInput(uint8_t const * p_data, size_t size)
+{
+    p_fuzz_data = p_data;
+    fuzz_size = size;
+
+    fuzz_reset();
+
+    while(0u != fuzz_size)
+    {
+        uint8_t const op = fuzz_byte() % 16u;
+        uint8_t const instance_num = fuzz_byte() % FUZZ_INSTANCES;
+        uint64_t const start = fuzz_now();
+
+        fuzz_call(op, instance_num);
+
+        uint64_t const cost = fuzz_now() - start;
+
+        if(!rotary_encoder_check_invariants())
+        {
+            fprintf(stderr, "fuzz_api: invariants broken after call %u, %lu bytes left\n",
+                    op, (unsigned long)fuzz_size);
+            abort();
+        }
+
+        if(FUZZ_CALL_BUDGET < cost)
+        {
+            fprintf(stderr, "fuzz_api: call %u on instance %u took %llu ns, %lu bytes left\n",
+                    op, instance_num, (unsigned long long)cost, (unsigned long)fuzz_size);
+            abort();
+        }
+    }
+
+    return 0;
+}
+
+#ifdef FUZZ_MAIN
+/// Inputs tried when no files are given
+#define FUZZ_RUNS 100000u
+
+/// Longest input tried when no files are given
+#define FUZZ_LENGTH 512u
+
+int main(int argc, char * argv[])
+{
+    static uint8_t data_arr[1u << 16];
+
+    for(int n = 1; n < argc; n++)
+    {
+        FILE * const p_file = fopen(argv[n], "rb");
+
+        if(0 == p_file)
+        {
+            fprintf(stderr, "fuzz_api: can not open %s\n", argv[n]);
+            return 1;
+        }
+
+        size_t const size = fread(data_arr, 1u, sizeof(data_arr), p_file);
+
+        fclose(p_file);
+        LLVMFuzzerTestOneInput(data_arr, size);
+    }
+
+    if(1 >= argc)
+    {
+        uint32_t seed = 1u;
+
+        for(uint32_t r = 0; r < FUZZ_RUNS; r++)
+        {
+            size_t const size = r % FUZZ_LENGTH;
+
+            for(size_t n = 0; n < size; n++)
+            {
+                seed = (seed * 1664525u) + 1013904223u;
+                data_arr[n] = (uint8_t)(seed >> 24);
+            }
+
+            LLVMFuzzerTestOneInput(data_arr, size);
+        }
+
+        printf("fuzz_api: %lu random inputs, no failures\n", (unsigned long)FUZZ_RUNS);
+    }
+
+    return 0;
+}
+#endif
@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+#
+# gen_board.py
+#
+# Turns a JSON board description into two headers:
+#     <prefix>_config.h  Options sized for the board, for ROTARY_ENCODER_CONFIG_FILE
+#     <prefix>.h         Instance numbers, pin maps and a const table for
+#                        rotary_encoder_init_all()
+#
+# Usage: tools/gen_board.py board.json out/board_encoders
+# then build with -DROTARY_ENCODER_CONFIG_FILE=\"board_encoders_config.h\"
+# See tools/board_example.json for the description format.
+#
+
+import json
+import os
+import re
+import sys
+
+INSTANCES_MAX = 32
+INT16_MIN = -32768
+INT16_MAX = 32767
+IDENT = re.compile(r'^[A-Za-z_][A-Za-z0-9_]*$')
+
+
+def fail(msg):
+    sys.stderr.write('gen_board.py: %s\n' % msg)
+    sys.exit(1)
+
+
+def is_int(value):
+    # JSON true and false load as bool, which Python counts as an int
+    return isinstance(value, int) and not isinstance(value, bool)
+
+
+def guard(path):
+    return re.sub(r'[^A-Za-z0-9]', '_', os.path.basename(path)).upper() + '_'
+
+
+def check(board):
+    encoders = board.get('encoders')
+
+    if not isinstance(encoders, list) or not encoders:
+        fail('"encoders" must be a list with at least one entry')
+
+    if len(encoders) > INSTANCES_MAX:
+        fail('%d encoders, the module supports up to %d' %
+             (len(encoders), INSTANCES_MAX))
+
+    names = set()
+
+    for n, enc in enumerate(encoders):
+        name = enc.get('name', '')
+
+        if not IDENT.match(name):
+            fail('encoder %d: name "%s" is not a C identifier' % (n, name))
+        if name.upper() in names:
+            fail('encoder %d: name "%s" used twice' % (n, name))
+        names.add(name.upper())
+
+        lo = enc.get('min', 0)
+        hi = enc.get('max')
+
+        if not is_int(lo) or not is_int(hi):
+            fail('%s: min and max must be integers' % name)
+        if not INT16_MIN <= lo <= hi <= INT16_MAX:
+            fail('%s: need %d <= min <= max <= %d' % (name, INT16_MIN, INT16_MAX))
+
+        bank = enc.get('bank', 0)
+
+        if not is_int(bank) or not 0 <= bank < INSTANCES_MAX:
+            fail('%s: bank must be an integer from 0 to %d' %
+                 (name, INSTANCES_MAX - 1))
+
+        for pin, value in enc.get('pins', {}).items():
+            if not IDENT.match(pin):
+                fail('%s: pin name "%s" is not a C identifier' % (name, pin))
+            if not isinstance(value, str) and not is_int(value):
+                fail('%s: pin "%s" must be a string or an integer' % (name, pin))
+
+    for option in board.get('options', {}):
+        if not option.startswith('ROTARY_ENCODER_') or not IDENT.match(option):
+            fail('option "%s" is not a ROTARY_ENCODER_ option' % option)
+        if option in ('ROTARY_ENCODER_INSTANCES', 'ROTARY_ENCODER_BANKS'):
+            fail('%s is worked out from the encoders' % option)
+
+
+def c_value(value):
+    if isinstance(value, bool):
+        return '1u' if value else '0u'
+    if isinstance(value, int) and value >= 0:
+        return '%du' % value
+    return str(value)
+
+
+def config_header(board, path, source):
+    encoders = board['encoders']
+    banks = max(enc.get('bank', 0) for enc in encoders) + 1
+    options = dict(board.get('options', {}))
+    lines = []
+
+    lines.append('///')
+    lines.append('/// Generated by tools/gen_board.py from %s, do not edit' % source)
+    lines.append('///')
+    lines.append('/// Name this file with ROTARY_ENCODER_CONFIG_FILE.')
+    lines.append('///')
+    lines.append('')
+    lines.append('#ifndef %s' % guard(path))
+    lines.append('#define %s' % guard(path))
+    lines.append('')
+    lines.append('/// One instance per encoder on the board')
+    lines.append('#define ROTARY_ENCODER_INSTANCES %du' % len(encoders))
+
+    if banks > 1:
+        # Banks are read from other cores, the module needs the sequence locks
+        options.setdefault('ROTARY_ENCODER_MULTI_READER', 1)
+        lines.append('#define ROTARY_ENCODER_BANKS %du' % banks)
+
+    for option in sorted(options):
+        lines.append('#define %s %s' % (option, c_value(options[option])))
+
+    lines.append('')
+    lines.append('#endif /* %s */' % guard(path))
+
+    return '\n'.join(lines) + '\n'
+
+
+def table_header(board, path, config_path, source):
+    encoders = board['encoders']
+    prefix = board.get('prefix', 'board_encoder')
+
+    if not IDENT.match(prefix):
+        fail('prefix "%s" is not a C identifier' % prefix)
+
+    macro = prefix.upper()
+    lines = []
+
+    lines.append('///')
+    lines.append('/// Generated by tools/gen_board.py from %s, do not edit' % source)
+    lines.append('///')
+    lines.append('/// Include from the one file that calls rotary_encoder_init_all(),')
+    lines.append('/// the table is static so every includer gets its own copy.')
+    lines.append('///')
+    lines.append('')
+    lines.append('#ifndef %s' % guard(path))
+    lines.append('#define %s' % guard(path))
+    lines.append('')
+    lines.append('#include "%s"' % os.path.basename(config_path))
+    lines.append('#include "rotary_encoders.h"')
+    lines.append('')
+    lines.append('/// Instance number of each encoder')
+
+    for n, enc in enumerate(encoders):
+        lines.append('#define %s_%s %du' % (macro, enc['name'].upper(), n))
+
+    lines.append('')
+    lines.append('/// Entries in %s_table' % prefix)
+    lines.append('#define %s_COUNT %du' % (macro, len(encoders)))
+
+    pin_lines = []
+
+    for enc in encoders:
+        for pin, value in sorted(enc.get('pins', {}).items()):
+            pin_lines.append('#define %s_%s_%s %s' %
+                             (macro, enc['name'].upper(), pin.upper(),
+                              c_value(value)))
+
+    if pin_lines:
+        lines.append('')
+        lines.append('/// Pins of each encoder')
+        lines.extend(pin_lines)
+
+    lines.append('')
+    lines.append('/// Pass to rotary_encoder_init_all(%s_table, %s_COUNT)' %
+                 (prefix, macro))
+    lines.append('static rotary_encoder_config_t const %s_table[%s_COUNT] =' %
+                 (prefix, macro))
+    lines.append('{')
+
+    for enc in encoders:
+        lines.append('    [%s_%s] = {%d, %d, %s, %s, %du},' %
+                     (macro, enc['name'].upper(),
+                      enc.get('min', 0), enc['max'],
+                      'true' if enc.get('step_on', True) else 'false',
+                      'true' if enc.get('cw_positive', True) else 'false',
+                      enc.get('bank', 0)))
+
+    lines.append('};')
+    lines.append('')
+    lines.append('#endif /* %s */' % guard(path))
+
+    return '\n'.join(lines) + '\n'
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write('usage: gen_board.py board.json out/prefix\n')
+        return 2
+
+    source, out_prefix = argv[1], argv[2]
+
+    try:
+        with open(source) as f:
+            board = json.load(f)
+    except (OSError, ValueError) as e:
+        fail('%s: %s' % (source, e))
+
+    check(board)
+
+    config_path = out_prefix + '_config.h'
+    table_path = out_prefix + '.h'
+    name = os.path.basename(source)
+
+    try:
+        out_dir = os.path.dirname(out_prefix)
+
+        if out_dir:
+            os.makedirs(out_dir, exist_ok=True)
+
+        with open(config_path, 'w') as f:
+            f.write(config_header(board, config_path, name))
+
+        with open(table_path, 'w') as f:
+            f.write(table_header(board, table_path, config_path, name))
+    except OSError as e:
+        fail('%s: %s' % (out_prefix, e))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,76 @@
+#!/bin/sh
+#
+# size_report.sh
+#
+# Builds rotary_encoders.c once per configuration option and prints the
+# flash (text + data) and RAM (data + bss) each option adds to the base.
+#
+# Usage: tools/size_report.sh
+# Cross compile by setting CC and SIZE, for example
+#     CC=arm-none-eabi-gcc SIZE=arm-none-eabi-size \
+#     CFLAGS="-Os -mcpu=cortex-m0plus -mthumb" tools/size_report.sh
+#
+
+CC=${CC:-cc}
+SIZE=${SIZE:-size}
+CFLAGS=${CFLAGS:--Os}
+
+SRC_DIR=$(cd "$(dirname "$0")/../src" && pwd)
+OBJ=$(mktemp)
+trap 'rm -f "$OBJ"' EXIT
+
+# Name and compiler flags of each configuration, base first
+CONFIGS="
+base|
+task_budget|-DROTARY_ENCODER_TASK_BUDGET=1
+multi_reader|-DROTARY_ENCODER_MULTI_READER=1
+frames_3|-DROTARY_ENCODER_FRAMES=3
+pass_hooks_2|-DROTARY_ENCODER_PASS_HOOKS=2
+banks_2|-DROTARY_ENCODER_BANKS=2 -DROTARY_ENCODER_MULTI_READER=1
+padded_layout|-DROTARY_ENCODER_PADDED_LAYOUT=1
+atomic_flags|-DROTARY_ENCODER_ATOMIC_FLAGS=1
+glitch_filter|-DROTARY_ENCODER_GLITCH_FILTER=1 -DROTARY_ENCODER_TIMESTAMP()=0u
+storm_guard|-DROTARY_ENCODER_STORM_GUARD=1 -DROTARY_ENCODER_TIMESTAMP()=0u
+reversal_filter|-DROTARY_ENCODER_REVERSAL_FILTER=1 -DROTARY_ENCODER_TIMESTAMP()=0u
+inertia|-DROTARY_ENCODER_INERTIA=1
+slew|-DROTARY_ENCODER_SLEW=1
+params|-DROTARY_ENCODER_PARAMS=1
+delta_input|-DROTARY_ENCODER_DELTA_INPUT=1
+alert_bits|-DROTARY_ENCODER_ALERT_BITS=1
+notify_threshold|-DROTARY_ENCODER_NOTIFY_THRESHOLD=1
+latency|-DROTARY_ENCODER_LATENCY=1 -DROTARY_ENCODER_TIMESTAMP()=0u
+watchdog|-DROTARY_ENCODER_WATCHDOG=1 -DROTARY_ENCODER_TIMESTAMP()=0u
+self_check|-DROTARY_ENCODER_SELF_CHECK=1
+cost_budget|-DROTARY_ENCODER_COST_BUDGET=1 -DROTARY_ENCODER_TIMESTAMP()=0u
+"
+
+base_flash=0
+base_ram=0
+
+printf '%-16s %8s %8s %8s %8s\n' "config" "flash" "ram" "+flash" "+ram"
+
+echo "$CONFIGS" | while IFS='|' read -r name flags
+do
+    [ -z "$name" ] && continue
+
+    # shellcheck disable=SC2086
+    if ! $CC -std=c11 $CFLAGS $flags -I"$SRC_DIR" -c "$SRC_DIR/rotary_encoders.c" -o "$OBJ"
+    then
+        echo "$name: build failed" >&2
+        continue
+    fi
+
+    # Berkeley format: text data bss dec hex filename
+    set -- $($SIZE "$OBJ" | tail -n 1)
+    flash=$(($1 + $2))
+    ram=$(($2 + $3))
+
+    if [ "$name" = "base" ]
+    then
+        base_flash=$flash
+        base_ram=$ram
+    fi
+
+    printf '%-16s %8d %8d %+8d %+8d\n' "$name" "$flash" "$ram" \
+           $((flash - base_flash)) $((ram - base_ram))
+done